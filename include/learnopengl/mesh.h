@@ -6,7 +6,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include <learnopengl/shader.h>
+#include <learnopengl/shader_m.h>
+#include <rg/FrameStats.h>
+#include <rg/UniformId.h>
+#include <rg/VertexPacking.h>
 
 #include <string>
 #include <vector>
@@ -31,86 +34,244 @@ struct Texture {
     string path;
 };
 
+// what a mesh keeps on the CPU once its buffers are uploaded
+enum MeshRetention {
+    MESH_RETAIN_NONE,       // only the GPU buffers
+    MESH_RETAIN_POSITIONS,  // positions and indices, for collision and picking
+    MESH_RETAIN_ALL         // every vertex attribute and the indices
+};
+
+// the vertex layout of the GPU buffer
+enum MeshFormat {
+    MESH_FORMAT_FLOAT,      // Vertex as it is, 56 bytes
+    MESH_FORMAT_PACKED      // rg::PackedVertex, 16 bytes; draw with model.vs built with meshFormatDefines
+};
+
+// defines for model.vs matching the format of the meshes it draws
+inline string meshFormatDefines(MeshFormat format)
+{
+    return format == MESH_FORMAT_PACKED ? "#define PACKED_VERTICES\n" : "";
+}
+
+// bytes of one vertex in the GPU buffer
+inline size_t meshVertexSize(MeshFormat format)
+{
+    return format == MESH_FORMAT_PACKED ? sizeof(rg::PackedVertex) : sizeof(Vertex);
+}
+
+// the meshBounds uniform Mesh::Draw sets, see rg::packedBounds
+constexpr rg::UniformId MESH_BOUNDS_UNIFORM = rg::UniformId("meshBounds");
+
+// the box the packed positions of the vertices are stored in
+inline glm::vec4 meshBounds(const Vertex *vertexData, size_t vertexCount)
+{
+    if(vertexCount == 0)
+        return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    glm::vec3 low = vertexData[0].Position, high = vertexData[0].Position;
+    for(size_t i = 1; i < vertexCount; i++)
+    {
+        low = glm::min(low, vertexData[i].Position);
+        high = glm::max(high, vertexData[i].Position);
+    }
+    return rg::packedBounds(low, high);
+}
+
+// the vertices in the layout of MESH_FORMAT_PACKED, relative to bounds
+inline vector<rg::PackedVertex> packVertices(const Vertex *vertexData, size_t vertexCount, const glm::vec4 &bounds)
+{
+    vector<rg::PackedVertex> packed;
+    packed.reserve(vertexCount);
+    for(size_t i = 0; i < vertexCount; i++)
+        packed.push_back(rg::packVertex(vertexData[i].Position, vertexData[i].Normal, vertexData[i].TexCoords, bounds));
+    return packed;
+}
+
 class Mesh {
 public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    vector<glm::vec3>    positions;     // filled by retain(MESH_RETAIN_POSITIONS)
+    vector<rg::UniformId> samplers;     // sampler uniform of each texture, e.g. texture_diffuse1
     unsigned int VAO;
+    MeshFormat format;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    glm::vec4 bounds = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);   // offset and scale of packed positions, none for float ones
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, pass the vectors with std::move so they are taken over instead of copied
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, MeshFormat format = MESH_FORMAT_FLOAT)
+    : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), format(format)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+        setupSamplers();
+    }
+
+    // uploads from memory the mesh does not keep, such as a mapped mesh cache file; vertices and indices stay empty
+    Mesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, vector<Texture> textures,
+         MeshFormat format = MESH_FORMAT_FLOAT)
+    {
+        this->textures = std::move(textures);
+        this->format = format;
+        setupMesh(vertexData, vertexCount, indexData, indexCount);
+        setupSamplers();
+    }
+
+    // uploads vertices that are packed already relative to bounds, such as those of a packed mesh cache file, as they are
+    Mesh(const rg::PackedVertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, vector<Texture> textures,
+         const glm::vec4 &bounds)
+    {
+        this->textures = std::move(textures);
+        this->format = MESH_FORMAT_PACKED;
+        this->bounds = bounds;
+        setupBuffers(vertexData, vertexCount, indexData, indexCount);
+        setupSamplers();
     }
 
     // render the mesh
     void Draw(Shader &shader)
     {
         // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
             glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+            // now set the sampler to the correct texture unit, the shader skips it if the unit did not change
+            shader.setInt(samplers[i], i);
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
 
+        // set for float meshes too, the spot shadow program draws both kinds
+        shader.setVec4(MESH_BOUNDS_UNIFORM, bounds);
+
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        rg::frameStats().drawCalls++;
+        rg::frameStats().triangles += indexCount / 3;
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // frees what the retention does not keep of the CPU copy, the GPU buffers have all of it
+    void retain(MeshRetention retention)
+    {
+        if(retention == MESH_RETAIN_ALL)
+            return;
+        if(retention == MESH_RETAIN_POSITIONS && positions.empty())
+        {
+            positions.reserve(vertices.size());
+            for(const Vertex &vertex : vertices)
+                positions.push_back(vertex.Position);
+        }
+        vector<Vertex>().swap(vertices);
+        if(retention == MESH_RETAIN_NONE)
+        {
+            vector<unsigned int>().swap(indices);
+            vector<glm::vec3>().swap(positions);
+        }
+    }
+
+    // heap memory of the CPU copy
+    size_t cpuBytes() const
+    {
+        return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) + positions.capacity() * sizeof(glm::vec3);
+    }
+
+    // memory of the vertex and index buffers
+    size_t gpuBytes() const
+    {
+        return (size_t)vertexCount * meshVertexSize(format) + (size_t)indexCount * sizeof(unsigned int);
+    }
+
+    // frees the buffers, the textures belong to the model
+    void release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
 private:
     // render data
     unsigned int VBO, EBO;
 
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    // the sampler names are built once here, so Draw sets them without allocating
+    void setupSamplers()
     {
+        // retrieve texture number (the N in diffuse_textureN)
+        unsigned int diffuseNr  = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr   = 1;
+        unsigned int heightNr   = 1;
+        samplers.clear();
+        samplers.reserve(textures.size());
+        for(const Texture &texture : textures)
+        {
+            int number = 0;
+            if(texture.type == "texture_diffuse")
+                number = diffuseNr++;
+            else if(texture.type == "texture_specular")
+                number = specularNr++;
+            else if(texture.type == "texture_normal")
+                number = normalNr++;
+            else if(texture.type == "texture_height")
+                number = heightNr++;
+            samplers.push_back(number ? rg::uniformNumbered(texture.type.c_str(), number) : rg::UniformId(texture.type.c_str()));
+        }
+    }
+
+    // initializes all the buffer objects/arrays, packing the vertices first for MESH_FORMAT_PACKED
+    void setupMesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount)
+    {
+        if(format == MESH_FORMAT_PACKED)
+        {
+            bounds = meshBounds(vertexData, vertexCount);
+            vector<rg::PackedVertex> packed = packVertices(vertexData, vertexCount, bounds);
+            setupBuffers(packed.data(), vertexCount, indexData, indexCount);
+            return;
+        }
+        setupBuffers(vertexData, vertexCount, indexData, indexCount);
+    }
+
+    // uploads vertices already in the layout of format; the attributes keep their locations in both
+    void setupBuffers(const void *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount)
+    {
+        this->vertexCount = vertexCount;
+        this->indexCount = indexCount;
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
         glBindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * meshVertexSize(format), vertexData, GL_STATIC_DRAW);
+        if(format == MESH_FORMAT_PACKED)
+        {
+            // position in the box of bounds
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(rg::PackedVertex), (void*)offsetof(rg::PackedVertex, position));
+            // octahedral normal
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(rg::PackedVertex), (void*)offsetof(rg::PackedVertex, normal));
+            // texture coords
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(rg::PackedVertex), (void*)offsetof(rg::PackedVertex, texCoords));
+            glBindVertexArray(0);
+            return;
+        }
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);
@@ -121,12 +282,7 @@ private:
         // vertex texture coords
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        // the tangent and bitangent stay in the buffer but no shader reads them
 
         glBindVertexArray(0);
     }
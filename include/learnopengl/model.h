@@ -17,7 +17,11 @@
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
-#include <learnopengl/shader.h>
+#include <learnopengl/shader_m.h>
+#include <rg/AllocationStats.h>
+#include <rg/MeshCache.h>
+#include <rg/TextureLoader.h>
+#include <rg/VertexCacheOptimizer.h>
 
 #include <string>
 #include <fstream>
@@ -37,11 +41,41 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    rg::TextureLoader *textureLoader;   // decodes the textures in the background when set
+    string cacheDir;                    // meshes are cached here after the first import, see rg/MeshCache.h
+    bool cached = false;                // read from the mesh cache instead of imported
+    MeshRetention retention;            // what the meshes keep on the CPU after the upload
+    MeshFormat format;                  // vertex layout of the GPU buffers, the shaders need meshFormatDefines(format)
+    rg::MeshOptimization optimization;  // triangle and vertex order, applied at import and stored in the mesh cache
+    rg::AllocationCount meshAllocations = {0, 0};   // made while the meshes were built, without Assimp's own; zeros without RG_ALLOCATION_STATS
+    size_t importedCpuBytes = 0;        // CPU copy of the meshes before the retention freed it
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, rg::TextureLoader *textureLoader = nullptr, string const &cacheDir = "",
+          MeshRetention retention = MESH_RETAIN_ALL, MeshFormat format = MESH_FORMAT_FLOAT,
+          rg::MeshOptimization optimization = rg::MESH_OPTIMIZE_NONE)
+    : gammaCorrection(gamma), textureLoader(textureLoader), cacheDir(cacheDir), retention(retention), format(format),
+      optimization(optimization)
     {
         loadModel(path);
+        for(Mesh &mesh : meshes)
+        {
+            importedCpuBytes += mesh.cpuBytes();
+            mesh.retain(retention);
+        }
+    }
+
+    // Packed meshes that keep no CPU copy are cached packed and uploaded straight from the mapping; the others need
+    // the float vertices on the CPU, those are packed at upload
+    static MeshFormat cacheFormat(MeshRetention retention, MeshFormat format)
+    {
+        return format == MESH_FORMAT_PACKED && retention == MESH_RETAIN_NONE ? MESH_FORMAT_PACKED : MESH_FORMAT_FLOAT;
+    }
+
+    // the key of the mesh cache file of a model loaded with these options, 0 when the model is missing
+    static std::uint64_t cacheKey(string const &path, MeshRetention retention, MeshFormat format, rg::MeshOptimization optimization)
+    {
+        return rg::meshCacheKey(path, (std::uint64_t)optimization | (std::uint64_t)cacheFormat(retention, format) << 8);
     }
 
     // draws the model, and thus all its meshes
@@ -51,10 +85,44 @@ public:
             meshes[i].Draw(shader);
     }
 
+    // heap memory the meshes keep on the CPU
+    size_t cpuBytes() const
+    {
+        size_t bytes = 0;
+        for(const Mesh &mesh : meshes)
+            bytes += mesh.cpuBytes();
+        return bytes;
+    }
+
+    // memory of the vertex and index buffers of all meshes
+    size_t gpuBytes() const
+    {
+        size_t bytes = 0;
+        for(const Mesh &mesh : meshes)
+            bytes += mesh.gpuBytes();
+        return bytes;
+    }
+
+    // frees the buffers of the meshes, the textures stay
+    void release()
+    {
+        for(Mesh &mesh : meshes)
+            mesh.release();
+    }
+
 private:
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+        // a cache file written by an earlier run skips Assimp, it is keyed by the path, size and time of the model
+        // and the options that change what is stored
+        std::uint64_t key = cacheDir.empty() ? 0 : cacheKey(path, retention, format, optimization);
+        string cachePath = key ? rg::meshCachePath(cacheDir, key) : "";
+        if(key && loadCached(cachePath, key))
+            return;
+
         // read file via ASSIMP
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
@@ -64,11 +132,51 @@ private:
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
+        rg::AllocationCount before = rg::threadAllocations();
+        meshes.reserve(scene->mNumMeshes);
         processNode(scene->mRootNode, scene);
+        meshAllocations = rg::threadAllocations() - before;
+        if(key)
+            rg::saveMeshCache(cachePath, key, meshes, cacheFormat(retention, format));
+    }
+
+    // the meshes go from the mapped file to the GPU without a copy in between, unless the retention keeps one
+    bool loadCached(string const &cachePath, std::uint64_t key)
+    {
+        rg::MeshCacheFile file;
+        if(!file.open(cachePath, key))
+            return false;
+        rg::AllocationCount before = rg::threadAllocations();
+        meshes.reserve(file.meshCount());
+        for(unsigned int i = 0; i < file.meshCount(); i++)
+        {
+            const rg::MeshFileEntry &entry = file.mesh(i);
+            vector<Texture> textures;
+            textures.reserve(entry.textureCount);
+            for(unsigned int j = 0; j < entry.textureCount; j++)
+            {
+                const rg::MeshFileTexture &texture = file.texture(entry, j);
+                textures.push_back(loadTexture(file.textureName(texture), rg::MESH_TEXTURE_TYPES[texture.type]));
+            }
+            const unsigned int *indices = file.indices(entry);
+            if(file.vertexFormat() == MESH_FORMAT_PACKED)
+            {
+                meshes.push_back(Mesh(file.packedVertices(entry), entry.vertexCount, indices, entry.indexCount, std::move(textures),
+                                      file.packedBounds(entry)));
+                continue;
+            }
+            const Vertex *vertices = file.vertices(entry);
+            if(retention == MESH_RETAIN_NONE)
+                meshes.push_back(Mesh(vertices, entry.vertexCount, indices, entry.indexCount, std::move(textures), format));
+            else
+                meshes.push_back(Mesh(vector<Vertex>(vertices, vertices + entry.vertexCount),
+                                      vector<unsigned int>(indices, indices + entry.indexCount), std::move(textures), format));
+        }
+        meshAllocations = rg::threadAllocations() - before;
+        cached = true;
+        return true;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -96,6 +204,9 @@ private:
         vector<Vertex> vertices;
         vector<unsigned int> indices;
         vector<Texture> textures;
+        // sized up front, so the vertices and indices are allocated once and moved into the Mesh from here on
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -148,6 +259,9 @@ private:
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+        // reordered for the post transform cache and the vertex fetch, only when every face is a triangle
+        if(optimization != rg::MESH_OPTIMIZE_NONE && indices.size() == (size_t)mesh->mNumFaces * 3)
+            optimizeMesh(vertices, indices);
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -171,41 +285,56 @@ private:
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(std::move(vertices), std::move(indices), std::move(textures), format);
+    }
+
+    // prints the cache miss ratios before and after, the mesh cache keeps the result so this runs once per import
+    void optimizeMesh(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        rg::VertexCacheStats before = rg::analyzeVertexCache(indices, vertices.size());
+        rg::optimizeVertexCache(indices, vertices.size());
+        if(optimization == rg::MESH_OPTIMIZE_OVERDRAW)
+            rg::optimizeOverdraw(indices, vertices.size(), [&](unsigned int v) { return vertices[v].Position; });
+        rg::optimizeVertexFetch(vertices, indices);
+        rg::VertexCacheStats after = rg::analyzeVertexCache(indices, vertices.size());
+        cout << "Mesh " << meshes.size() << " of " << directory.substr(directory.find_last_of('/') + 1) << ": " << indices.size() / 3
+             << " triangles, ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << endl;
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
     // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string const &typeName)
     {
         vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            textures.push_back(loadTexture(str.C_Str(), typeName));
         }
         return textures;
     }
+
+    // one texture of a material, path relative to the model's directory
+    Texture loadTexture(string const &path, string const &typeName)
+    {
+        // check if texture was loaded before and if so, skip loading a new texture
+        for(unsigned int j = 0; j < textures_loaded.size(); j++)
+        {
+            if(textures_loaded[j].path == path)
+                return textures_loaded[j];
+        }
+        // if texture hasn't been loaded already, load it
+        Texture texture;
+        if (textureLoader)
+            texture.id = textureLoader->load2D(this->directory + '/' + path, rg::TEXTURE_REPEAT);
+        else
+            texture.id = TextureFromFile(path.c_str(), this->directory);
+        texture.type = typeName;
+        texture.path = path;
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return texture;
+    }
 };
 
 
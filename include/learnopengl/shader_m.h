@@ -4,18 +4,25 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <rg/FrameStats.h>
+#include <rg/UniformId.h>
+
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly, defines (e.g. "#define NAME\n") is added to both stages
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string &defines = "")
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -45,6 +52,9 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        // shared declarations such as the uniform blocks live in their own files
+        vertexCode = addDefines(expandIncludes(vertexCode, vertexPath), defines);
+        fragmentCode = addDefines(expandIncludes(fragmentCode, fragmentPath), defines);
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -68,7 +78,8 @@ public:
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-
+        // remember where every active uniform lives so the setters never have to ask GL again
+        reflectUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -76,66 +87,293 @@ public:
     { 
         glUseProgram(ID); 
     }
-    // utility uniform functions
+    // connects a uniform block of this program to a binding point, blocks the program does not use are ignored
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const char *name, unsigned int binding) const
+    {
+        unsigned int index = glGetUniformBlockIndex(ID, name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+    // location of a uniform from the table built after linking, -1 (ignored by glUniform*) if it is not active
+    // ------------------------------------------------------------------------
+    int location(rg::UniformId id) const
+    {
+        int slot = uniformSlot(id);
+        return slot < 0 ? -1 : uniformSlots[slot].location;
+    }
+    int location(const std::string &name) const
+    {
+        return location(rg::UniformId(name.c_str()));
+    }
+    // forgets the remembered values, needed after glUniform* calls that bypass the setters
+    // ------------------------------------------------------------------------
+    void invalidateUniforms() const
+    {
+        for (UniformSlot &slot : uniformSlots)
+            slot.size = 0;
+    }
+    // utility uniform functions, a value equal to the last one set for the same uniform is not sent again
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        setBool(rg::UniformId(name.c_str()), value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        setInt(rg::UniformId(name.c_str()), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        setFloat(rg::UniformId(name.c_str()), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec2(rg::UniformId(name.c_str()), value);
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        setVec2(rg::UniformId(name.c_str()), glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec3(rg::UniformId(name.c_str()), value);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        setVec3(rg::UniformId(name.c_str()), glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec4(rg::UniformId(name.c_str()), value);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) const
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        setVec4(rg::UniformId(name.c_str()), glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(rg::UniformId(name.c_str()), mat);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(rg::UniformId(name.c_str()), mat);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(rg::UniformId(name.c_str()), mat);
+    }
+    // the same setters taking a handle, e.g. setVec3(VIEW_POS, position) with constexpr UniformId VIEW_POS = "viewPos"_uniform,
+    // a lookup without building or hashing a string
+    // ------------------------------------------------------------------------
+    void setBool(rg::UniformId id, bool value) const
+    {
+        setInt(id, (int)value);
+    }
+    void setInt(rg::UniformId id, int value) const
+    {
+        int slot = uniformSlot(id);
+        if (changed(slot, value))
+            glUniform1i(uniformSlots[slot].location, value);
+    }
+    void setFloat(rg::UniformId id, float value) const
+    {
+        int slot = uniformSlot(id);
+        if (changed(slot, value))
+            glUniform1f(uniformSlots[slot].location, value);
+    }
+    void setVec2(rg::UniformId id, const glm::vec2 &value) const
+    {
+        int slot = uniformSlot(id);
+        if (changed(slot, value))
+            glUniform2fv(uniformSlots[slot].location, 1, &value[0]);
+    }
+    void setVec2(rg::UniformId id, float x, float y) const
+    {
+        setVec2(id, glm::vec2(x, y));
+    }
+    void setVec3(rg::UniformId id, const glm::vec3 &value) const
+    {
+        int slot = uniformSlot(id);
+        if (changed(slot, value))
+            glUniform3fv(uniformSlots[slot].location, 1, &value[0]);
+    }
+    void setVec3(rg::UniformId id, float x, float y, float z) const
+    {
+        setVec3(id, glm::vec3(x, y, z));
+    }
+    void setVec4(rg::UniformId id, const glm::vec4 &value) const
+    {
+        int slot = uniformSlot(id);
+        if (changed(slot, value))
+            glUniform4fv(uniformSlots[slot].location, 1, &value[0]);
+    }
+    void setVec4(rg::UniformId id, float x, float y, float z, float w) const
+    {
+        setVec4(id, glm::vec4(x, y, z, w));
+    }
+    void setMat2(rg::UniformId id, const glm::mat2 &mat) const
+    {
+        int slot = uniformSlot(id);
+        if (changed(slot, mat))
+            glUniformMatrix2fv(uniformSlots[slot].location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat3(rg::UniformId id, const glm::mat3 &mat) const
+    {
+        int slot = uniformSlot(id);
+        if (changed(slot, mat))
+            glUniformMatrix3fv(uniformSlots[slot].location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(rg::UniformId id, const glm::mat4 &mat) const
+    {
+        int slot = uniformSlot(id);
+        if (changed(slot, mat))
+            glUniformMatrix4fv(uniformSlots[slot].location, 1, GL_FALSE, &mat[0][0]);
     }
-
 private:
+    // an active uniform and the last value sent to it, size 0 until the first set
+    struct UniformSlot
+    {
+        int location;
+        unsigned int size;
+        float value[16];
+    };
+    // (name hash, slot) sorted by hash, names of the same location share the slot
+    std::vector<std::pair<unsigned int, int>> uniformIndex;
+    mutable std::vector<UniformSlot> uniformSlots;
+
+    int uniformSlot(rg::UniformId id) const
+    {
+        auto it = std::lower_bound(uniformIndex.begin(), uniformIndex.end(), id.hash,
+                                   [](const std::pair<unsigned int, int> &entry, unsigned int hash) { return entry.first < hash; });
+        if (it == uniformIndex.end() || it->first != id.hash)
+            return -1;
+        return it->second;
+    }
+
+    // remembers value and returns true if it differs from the last one sent to slot
+    template<typename T>
+    bool changed(int slot, const T &value) const
+    {
+        static_assert(sizeof(T) <= sizeof(UniformSlot::value), "uniform value does not fit the cache");
+        if (slot < 0)
+            return false;
+        UniformSlot &cached = uniformSlots[slot];
+        if (cached.size == sizeof(T) && std::memcmp(cached.value, &value, sizeof(T)) == 0)
+        {
+            rg::frameStats().uniformsSkipped++;
+            return false;
+        }
+        std::memcpy(cached.value, &value, sizeof(T));
+        cached.size = sizeof(T);
+        rg::frameStats().uniformsIssued++;
+        return true;
+    }
+
+    void addUniform(const std::string &name, int location)
+    {
+        int slot = 0;
+        while (slot < (int)uniformSlots.size() && uniformSlots[slot].location != location)
+            slot++;
+        if (slot == (int)uniformSlots.size())
+            uniformSlots.push_back(UniformSlot{location, 0, {}});
+        uniformIndex.emplace_back(rg::fnv1a(name.c_str()), slot);
+    }
+
+    // GL lists arrays of structs element by element and plain arrays once as name[0], the
+    // elements of plain arrays (and the bare array name) are added here so both spellings work
+    void reflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            int location = glGetUniformLocation(ID, name.c_str());
+            // members of uniform blocks have no location
+            if (location < 0)
+                continue;
+            addUniform(name, location);
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                addUniform(base, location);
+                for (GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()));
+                }
+            }
+        }
+        std::sort(uniformIndex.begin(), uniformIndex.end());
+        for (size_t i = 1; i < uniformIndex.size(); i++)
+        {
+            if (uniformIndex[i].first == uniformIndex[i - 1].first && uniformIndex[i].second != uniformIndex[i - 1].second)
+                std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION " << uniformIndex[i].first << std::endl;
+        }
+    }
+
+    // replaces every line #include "file" with the contents of file, relative to the directory of path
+    // ------------------------------------------------------------------------
+    static std::string expandIncludes(const std::string &code, const std::string &path, int depth = 0)
+    {
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::istringstream lines(code);
+        std::string result, line;
+        while (std::getline(lines, line))
+        {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+            {
+                result += line + "\n";
+                continue;
+            }
+            size_t open = line.find('"', start);
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            std::string includePath = close == std::string::npos ? "" : directory + line.substr(open + 1, close - open - 1);
+            std::ifstream includeFile;
+            // the depth limit stops files that include each other
+            if (!includePath.empty() && depth < 8)
+                includeFile.open(includePath);
+            if (!includeFile.is_open())
+            {
+                std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << path << ": " << line << std::endl;
+                continue;
+            }
+            std::stringstream included;
+            included << includeFile.rdbuf();
+            result += expandIncludes(included.str(), includePath, depth + 1);
+        }
+        return result;
+    }
+
+    // defines have to follow the #version line
+    // ------------------------------------------------------------------------
+    static std::string addDefines(const std::string &code, const std::string &defines)
+    {
+        if (defines.empty())
+            return code;
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return defines + code;
+        return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
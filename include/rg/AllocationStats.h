@@ -0,0 +1,29 @@
+//
+// Created by bambino on 3.3.21..
+//
+
+#ifndef PROJECT_BASE_ALLOCATIONSTATS_H
+#define PROJECT_BASE_ALLOCATIONSTATS_H
+
+namespace rg {
+
+    // heap allocations of one thread, counted by the operator new in tools/allocation_hook.cpp, which is only
+    // linked in when configured with -DRG_ALLOCATION_STATS=ON (that also defines RG_ALLOCATION_STATS); a program
+    // built without it sees zeros
+    struct AllocationCount {
+        unsigned long long allocations;
+        unsigned long long bytes;
+
+        AllocationCount operator-(const AllocationCount &other) const {
+            return AllocationCount{allocations - other.allocations, bytes - other.bytes};
+        }
+    };
+
+    // per thread, so the texture decoding workers do not show up in what the main thread measures
+    inline AllocationCount &threadAllocations() {
+        static thread_local AllocationCount count = {0, 0};
+        return count;
+    }
+
+};
+#endif //PROJECT_BASE_ALLOCATIONSTATS_H
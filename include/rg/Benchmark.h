@@ -0,0 +1,813 @@
+//
+// Created by bambino on 19.2.21..
+//
+
+#ifndef PROJECT_BASE_BENCHMARK_H
+#define PROJECT_BASE_BENCHMARK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader_m.h>
+#include <rg/AllocationStats.h>
+#include <rg/ClusteredLights.h>
+#include <rg/DeferredRenderer.h>
+#include <rg/Frustum.h>
+#include <rg/GpuTimer.h>
+#include <rg/LightGrid.h>
+#include <rg/Maze.h>
+#include <rg/MazeMaterials.h>
+#include <rg/MazeMesh.h>
+#include <rg/MazeWorld.h>
+#include <rg/NormalMatrix.h>
+#include <rg/SurfaceLighting.h>
+#include <rg/UniformBuffer.h>
+#include <rg/UniformId.h>
+#include <rg/Visibility.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rg {
+
+    // runs body(frame) frames times and returns the nanoseconds per uniform set, setsPerFrame sets per frame
+    template<typename F>
+    double timeUniformSets(unsigned int frames, unsigned int setsPerFrame, F body) {
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int frame = 0; frame < frames; frame++)
+            body((float)frame);
+        glFinish();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / ((double)frames * setsPerFrame);
+    }
+
+    // Cost of setting five point lights as plain uniforms (as the render loop did before the uniform blocks):
+    // glGetUniformLocation on a concatenated name, the cached string setters and the handle setters. The values
+    // change every frame so the setters really upload, the last run repeats the same values and is all skipped.
+    inline void benchmarkUniforms(unsigned int frames = 2000) {
+        Shader shader("resources/shaders/uniform_bench.vs", "resources/shaders/uniform_bench.fs");
+        const char *vec3Members[] = {"position", "ambient", "diffuse", "specular"};
+        const char *floatMembers[] = {"constant", "linear", "quadratic"};
+        const unsigned int setsPerFrame = 5 * 7;
+        shader.use();
+
+        double uncached = timeUniformSets(frames, setsPerFrame, [&](float frame) {
+            glm::vec3 value(frame);
+            for (int i = 0; i < 5; i++) {
+                for (const char *member : vec3Members)
+                    glUniform3fv(glGetUniformLocation(shader.ID, ("pointLights[" + std::to_string(i) + "]." + member).c_str()), 1, &value[0]);
+                for (const char *member : floatMembers)
+                    glUniform1f(glGetUniformLocation(shader.ID, ("pointLights[" + std::to_string(i) + "]." + member).c_str()), frame);
+            }
+        });
+        shader.invalidateUniforms();
+        double cachedString = timeUniformSets(frames, setsPerFrame, [&](float frame) {
+            glm::vec3 value(frame);
+            for (int i = 0; i < 5; i++) {
+                for (const char *member : vec3Members)
+                    shader.setVec3("pointLights[" + std::to_string(i) + "]." + member, value);
+                for (const char *member : floatMembers)
+                    shader.setFloat("pointLights[" + std::to_string(i) + "]." + member, frame);
+            }
+        });
+        auto handleSets = [&](float frame) {
+            glm::vec3 value(frame);
+            for (int i = 0; i < 5; i++) {
+                for (const char *member : vec3Members)
+                    shader.setVec3(uniformAt("pointLights", i, member), value);
+                for (const char *member : floatMembers)
+                    shader.setFloat(uniformAt("pointLights", i, member), frame);
+            }
+        };
+        double handle = timeUniformSets(frames, setsPerFrame, handleSets);
+        static constexpr UniformId VIEW_POS_UNIFORM = "viewPos"_uniform;
+        double literal = timeUniformSets(frames, setsPerFrame, [&](float frame) {
+            for (unsigned int i = 0; i < setsPerFrame; i++)
+                shader.setVec3(VIEW_POS_UNIFORM, glm::vec3(frame + i));
+        });
+        double unchanged = timeUniformSets(frames, setsPerFrame, [&](float) { handleSets(0.0f); });
+
+        glDeleteProgram(shader.ID);
+        std::cout << "uniform set cost over " << frames << " frames of " << setsPerFrame << " sets:\n"
+                  << "  glGetUniformLocation + string    " << uncached << " ns\n"
+                  << "  cached location, string name     " << cachedString << " ns\n"
+                  << "  cached location, uniformAt       " << handle << " ns\n"
+                  << "  cached location, literal handle  " << literal << " ns\n"
+                  << "  unchanged value, skipped         " << unchanged << " ns" << std::endl;
+    }
+
+    // GPU time of the maze vertex stage (up to 256x256 cells of walls and floor) with each normal transform
+    // variant of maze.vs, measured with timer queries while the rasterizer is off so only vertices count
+    inline void benchmarkNormalMatrix(const Maze &maze, MazeMeshMode mode, unsigned int frames = 200) {
+        MazeRect rect{0, 0, std::min(maze.width, 256), std::min(maze.height, 256)};
+        MazeMesh mesh;
+        mesh.upload(buildMazeMesh(maze, mode, rect));
+
+        FrameData frameData;
+        frameData.projection = glm::mat4(1.0f);
+        frameData.view = glm::mat4(1.0f);
+        UniformBuffer frameBuffer;
+        frameBuffer.create(sizeof(FrameData), FRAME_DATA_BINDING, &frameData);
+        GpuTimer timer;
+        timer.create();
+        glEnable(GL_RASTERIZER_DISCARD);
+
+        std::cout << "vertex stage of " << rect.width() << "x" << rect.height() << " cells over " << frames << " frames:\n";
+        for (NormalMatrixMode variant : {NORMALS_TRANSLATION_ONLY, NORMALS_UNIFORM, NORMALS_PER_VERTEX}) {
+            Shader shader("resources/shaders/maze.vs", "resources/shaders/maze.fs", normalMatrixDefines(variant));
+            shader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+            shader.use();
+            shader.setMat4("model", glm::mat4(1.0f));
+            shader.setMat3("normalMatrix", normalMatrix(glm::mat4(1.0f)));
+
+            // the first frame includes the driver finishing the program
+            mesh.Draw();
+            double total = 0.0;
+            for (unsigned int frame = 0; frame < frames; frame++) {
+                timer.begin();
+                mesh.Draw();
+                timer.end();
+                total += timer.finish();
+            }
+            std::cout << "  " << normalMatrixModeName(variant) << ": " << total / frames << " ms" << std::endl;
+            glDeleteProgram(shader.ID);
+        }
+
+        glDisable(GL_RASTERIZER_DISCARD);
+        timer.release();
+        frameBuffer.release();
+        mesh.release();
+    }
+
+    // Each maze mesh builder on every cell of each maze, cut into chunkSize chunks as MazeWorld does: triangles,
+    // draw calls and vertex bytes of one frame, the CPU time of the build and the GPU time of the vertex stage
+    // (rasterizer off) and of the whole maze drawn from above. The chunks are uploaded and timed in batches of at
+    // most batchBytes and the times of the batches added up, so the cubes of a 1024x1024 maze (about 2 GB) do not
+    // have to fit on the GPU at once.
+    inline void benchmarkMeshModes(const std::vector<Maze> &mazes, int chunkSize, unsigned int frames = 100,
+                                   std::size_t batchBytes = 256 * 1024 * 1024) {
+        chunkSize = std::max(chunkSize, 1);
+
+        unsigned int white;
+        std::vector<unsigned char> texels(MAZE_TEXTURE_LAYER_COUNT * 4, 255);
+        glGenTextures(1, &white);
+        glActiveTexture(GL_TEXTURE0 + MAZE_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, white);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, MAZE_TEXTURE_LAYER_COUNT, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glActiveTexture(GL_TEXTURE0);
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        UniformBuffer frameBuffer;
+        frameBuffer.create(sizeof(FrameData), FRAME_DATA_BINDING);
+        GpuTimer timer;
+        timer.create();
+
+        Shader shader("resources/shaders/maze.vs", "resources/shaders/maze.fs", normalMatrixDefines(NORMALS_TRANSLATION_ONLY));
+        shader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+        shader.use();
+        shader.setMat4("model", glm::mat4(1.0f));
+        shader.setInt("mazeTextures", MAZE_TEXTURE_UNIT);
+        setMazeLighting(shader);
+
+        std::cout << chunkSize << "x" << chunkSize << " chunks over " << frames << " frames\n"
+                  << "maze | mesh | triangles | draw calls | vertex KB | build ms (cpu) | vertices ms (gpu) | frame ms (gpu)" << std::endl;
+        for (const Maze &maze : mazes) {
+            MazeRect rect{0, 0, maze.width, maze.height};
+            float size = (float)std::max(rect.width(), rect.height());
+            glm::vec3 center(rect.width() * 0.5f, 0.0f, rect.height() * 0.5f);
+            glm::vec3 eye = center + glm::vec3(0.0f, size, 1.0f);
+            FrameData frameData;
+            frameData.projection = glm::perspective(glm::radians(45.0f), (float)viewport[2] / (float)std::max(viewport[3], 1), 0.1f, 2.0f * size + 10.0f);
+            frameData.view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+            frameData.viewPos = glm::vec4(eye, 1.0f);
+            frameData.spotPosition = frameData.viewPos;
+            frameData.viewFront = glm::vec4(glm::normalize(center - eye), 0.0f);
+            frameBuffer.update(&frameData);
+
+            for (MazeMeshMode mode : {MAZE_MESH_CUBES, MAZE_MESH_CULLED, MAZE_MESH_GREEDY}) {
+                std::vector<MazeMesh> chunks;
+                std::size_t vertexBytes = 0, batch = 0, triangles = 0, drawCalls = 0;
+                double build = 0.0, vertices = 0.0, frame = 0.0;
+
+                // GPU time of one frame of every chunk, averaged over frames, the first one is not timed
+                auto drawTime = [&]() {
+                    for (const MazeMesh &chunk : chunks)
+                        chunk.Draw();
+                    double total = 0.0;
+                    for (unsigned int f = 0; f < frames; f++) {
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        timer.begin();
+                        for (const MazeMesh &chunk : chunks)
+                            chunk.Draw();
+                        timer.end();
+                        total += timer.finish();
+                    }
+                    return total / frames;
+                };
+                auto flush = [&]() {
+                    glEnable(GL_RASTERIZER_DISCARD);
+                    vertices += drawTime();
+                    glDisable(GL_RASTERIZER_DISCARD);
+                    frame += drawTime();
+                    frameStats().reset();
+                    for (const MazeMesh &chunk : chunks)
+                        chunk.Draw();
+                    triangles += frameStats().triangles;
+                    drawCalls += frameStats().drawCalls;
+                    for (MazeMesh &chunk : chunks)
+                        chunk.release();
+                    chunks.clear();
+                    batch = 0;
+                };
+                for (int z = rect.z0; z < rect.z1; z += chunkSize) {
+                    for (int x = rect.x0; x < rect.x1; x += chunkSize) {
+                        auto start = std::chrono::steady_clock::now();
+                        MazeMeshData data = buildMazeMesh(maze, mode, MazeRect{x, z, std::min(x + chunkSize, rect.x1), std::min(z + chunkSize, rect.z1)});
+                        build += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                        vertexBytes += data.vertices.size() * sizeof(MazeVertex);
+                        batch += data.vertices.size() * sizeof(MazeVertex) + data.indices.size() * sizeof(unsigned int);
+                        chunks.push_back(MazeMesh(data));
+                        if (batch >= batchBytes)
+                            flush();
+                    }
+                }
+                if (!chunks.empty())
+                    flush();
+                std::cout << rect.width() << "x" << rect.height() << " | " << mazeMeshModeName(mode) << " | " << triangles << " | "
+                          << drawCalls << " | " << vertexBytes / 1024 << " | " << build << " | " << vertices << " | " << frame << std::endl;
+            }
+        }
+
+        glDeleteProgram(shader.ID);
+        glDeleteTextures(1, &white);
+        timer.release();
+        frameBuffer.release();
+    }
+
+    // Frame time of the streamed maze with frustum culling only and with GridVisibility on top, from viewpoints
+    // spread over the maze, each looking down its longest corridor; meant for a large --generate maze. Prints the
+    // chunks drawn, the visible cells and triangles per frame, the CPU time of streaming and culling and the GPU
+    // time of the maze pass, averaged over the viewpoints.
+    inline void benchmarkOcclusion(const Maze &maze, MazeMeshMode mode, int chunkSize, float radius, unsigned int frames = 50) {
+        std::vector<glm::vec3> openCells;
+        for (int z = 0; z < maze.height; z++) {
+            for (int x = 0; x < maze.width; x++) {
+                if (!maze.isWall(x, z))
+                    openCells.push_back(glm::vec3(x, 0.0f, z));
+            }
+        }
+        if (openCells.empty()) {
+            std::cout << "ERROR::BENCHMARK::NO_OPEN_CELLS" << std::endl;
+            return;
+        }
+        std::mt19937 random(1);
+        std::shuffle(openCells.begin(), openCells.end(), random);
+        openCells.resize(std::min<std::size_t>(openCells.size(), 16));
+
+        unsigned int white;
+        std::vector<unsigned char> texels(MAZE_TEXTURE_LAYER_COUNT * 4, 255);
+        glGenTextures(1, &white);
+        glActiveTexture(GL_TEXTURE0 + MAZE_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, white);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, MAZE_TEXTURE_LAYER_COUNT, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glActiveTexture(GL_TEXTURE0);
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        float aspect = (float)viewport[2] / (float)std::max(viewport[3], 1);
+        float fov = glm::radians(45.0f);
+        float horizontalFov = 2.0f * std::atan(std::tan(fov * 0.5f) * aspect);
+        glm::mat4 projection = glm::perspective(fov, aspect, 0.1f, radius);
+        UniformBuffer frameBuffer;
+        frameBuffer.create(sizeof(FrameData), FRAME_DATA_BINDING);
+        GpuTimer timer;
+        timer.create();
+
+        Shader shader("resources/shaders/maze.vs", "resources/shaders/maze.fs", normalMatrixDefines(NORMALS_TRANSLATION_ONLY));
+        shader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+        shader.use();
+        shader.setMat4("model", glm::mat4(1.0f));
+        shader.setInt("mazeTextures", MAZE_TEXTURE_UNIT);
+        setMazeLighting(shader);
+
+        MazeWorld world(maze, mode, chunkSize, 1u << 16);
+        GridVisibility visibility;
+        struct Totals {
+            double chunks = 0.0, cells = 0.0, triangles = 0.0, cpuMs = 0.0, gpuMs = 0.0;
+        } totals[2];
+        for (const glm::vec3 &position : openCells) {
+            glm::vec3 front(1.0f, 0.0f, 0.0f);
+            int longest = -1;
+            for (glm::vec3 direction : {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)}) {
+                int length = 0;
+                while (length < 100 && !maze.isWall((int)position.x + (int)direction.x * (length + 1), (int)position.z + (int)direction.z * (length + 1)))
+                    length++;
+                if (length > longest) {
+                    longest = length;
+                    front = direction;
+                }
+            }
+            glm::mat4 view = glm::lookAt(position, position + front, glm::vec3(0.0f, 1.0f, 0.0f));
+            Frustum frustum = Frustum::fromMatrix(projection * view);
+            FrameData frameData;
+            frameData.projection = projection;
+            frameData.view = view;
+            frameData.viewPos = glm::vec4(position, 1.0f);
+            frameData.spotPosition = frameData.viewPos;
+            frameData.viewFront = glm::vec4(front, 0.0f);
+            frameBuffer.update(&frameData);
+
+            // every chunk in the radius is resident before the frames are timed
+            world.update(position, radius, 1u << 16);
+            while (world.pendingCount() > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                world.update(position, radius, 1u << 16);
+            }
+
+            for (int occlusion = 0; occlusion < 2; occlusion++) {
+                Totals &total = totals[occlusion];
+                for (unsigned int frame = 0; frame <= frames; frame++) {
+                    frameStats().reset();
+                    auto start = std::chrono::steady_clock::now();
+                    world.update(position, radius);
+                    world.cull(frustum);
+                    if (occlusion && visibility.compute(maze, position, front, horizontalFov, radius)) {
+                        world.cullOccluded(visibility);
+                        frameStats().visibleCells = visibility.visibleCount();
+                    }
+                    std::chrono::duration<double, std::milli> cpu = std::chrono::steady_clock::now() - start;
+
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    timer.begin();
+                    world.drawMaze();
+                    timer.end();
+                    double gpu = timer.finish();
+                    // the first frame includes the driver finishing the program
+                    if (frame == 0)
+                        continue;
+                    total.chunks += frameStats().chunks;
+                    total.cells += occlusion ? frameStats().visibleCells : 0;
+                    total.triangles += frameStats().triangles;
+                    total.cpuMs += cpu.count();
+                    total.gpuMs += gpu;
+                }
+            }
+        }
+
+        double samples = (double)openCells.size() * frames;
+        std::cout << maze.width << "x" << maze.height << " maze, " << mazeMeshModeName(mode) << " mesh, " << openCells.size()
+                  << " viewpoints over " << frames << " frames, stream radius " << radius << "\n"
+                  << "culling | chunks | visible cells | triangles | cull ms (cpu) | maze ms (gpu)" << std::endl;
+        for (int occlusion = 0; occlusion < 2; occlusion++) {
+            const Totals &total = totals[occlusion];
+            std::cout << (occlusion ? "frustum + grid visibility" : "frustum") << " | " << total.chunks / samples << " | ";
+            if (occlusion)
+                std::cout << total.cells / samples;
+            else
+                std::cout << "-";
+            std::cout << " | " << total.triangles / samples << " | " << total.cpuMs / samples << " | " << total.gpuMs / samples << std::endl;
+        }
+
+        world.shutdown();
+        glDeleteProgram(shader.ID);
+        glDeleteTextures(1, &white);
+        timer.release();
+        frameBuffer.release();
+    }
+
+    // Sweeps the lantern count over a 128x128 cell corner of the maze seen from above. For every count it prints the
+    // CPU time of the cell flood fill and of the cluster assignment, and the GPU time of the maze pass with
+    // per cell lists, per cluster lists and with every light.
+    inline void benchmarkLights(const Maze &maze, MazeMeshMode mode, unsigned int frames = 50) {
+        MazeRect rect{0, 0, std::min(maze.width, 128), std::min(maze.height, 128)};
+        MazeMesh mesh;
+        mesh.upload(buildMazeMesh(maze, mode, rect));
+
+        std::vector<glm::vec3> openCells;
+        for (int z = rect.z0; z < rect.z1; z++) {
+            for (int x = rect.x0; x < rect.x1; x++) {
+                if (!maze.isWall(x, z))
+                    openCells.push_back(glm::vec3(x, 1.0f, z));
+            }
+        }
+        std::mt19937 random(1);
+        std::shuffle(openCells.begin(), openCells.end(), random);
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glm::vec3 center(rect.width() * 0.5f, 0.0f, rect.height() * 0.5f);
+        glm::vec3 eye = center + glm::vec3(0.0f, 40.0f, 30.0f);
+        glm::mat4 view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)viewport[2] / (float)std::max(viewport[3], 1), 0.1f, 100.0f);
+        FrameData frameData;
+        frameData.projection = projection;
+        frameData.view = view;
+        frameData.viewPos = glm::vec4(eye, 1.0f);
+        frameData.spotPosition = frameData.viewPos;
+        frameData.viewFront = glm::vec4(glm::normalize(center - eye), 0.0f);
+        UniformBuffer frameBuffer;
+        frameBuffer.create(sizeof(FrameData), FRAME_DATA_BINDING);
+        LightClusters clusters;
+        clusters.create();
+        LightGrid grid;
+        grid.create();
+        GpuTimer timer;
+        timer.create();
+
+        std::string defines = normalMatrixDefines(NORMALS_TRANSLATION_ONLY);
+        Shader cells("resources/shaders/maze.vs", "resources/shaders/maze.fs", defines + lightCullingDefines(LIGHT_CULLING_CELLS));
+        Shader clustered("resources/shaders/maze.vs", "resources/shaders/maze.fs", defines + lightCullingDefines(LIGHT_CULLING_CLUSTERS));
+        Shader unclustered("resources/shaders/maze.vs", "resources/shaders/maze.fs", defines + "#define LIGHTS_UNCLUSTERED\n");
+        for (const Shader *shader : {&cells, &clustered, &unclustered}) {
+            shader->bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+            shader->use();
+            shader->setMat4("model", glm::mat4(1.0f));
+            setMazeLighting(*shader);
+            shader->setInt("lightData", LIGHT_DATA_UNIT);
+            shader->setInt("clusterGrid", CLUSTER_GRID_UNIT);
+            shader->setInt("lightIndices", LIGHT_INDEX_UNIT);
+            shader->setInt("cellLightGrid", CELL_GRID_UNIT);
+            shader->setInt("cellLightIndices", CELL_INDEX_UNIT);
+        }
+
+        // GPU time of one frame of the maze drawn with shader, averaged over frames
+        auto drawTime = [&](const Shader &shader) {
+            shader.use();
+            double total = 0.0;
+            for (unsigned int frame = 0; frame < frames; frame++) {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                timer.begin();
+                mesh.Draw();
+                timer.end();
+                total += timer.finish();
+            }
+            return total / frames;
+        };
+
+        std::cout << "lights | cell entries | flood fill ms (cpu) | cluster entries | assign ms (cpu) | cells ms (gpu) | clustered ms (gpu) | every light ms (gpu)" << std::endl;
+        for (unsigned int count : {5u, 50u, 200u, 500u, 1000u, 2000u}) {
+            count = std::min<unsigned int>(count, openCells.size());
+            clusters.setLights(std::vector<glm::vec3>(openCells.begin(), openCells.begin() + count), glm::vec3(1.0f, 0.22f, 0.20f));
+
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int frame = 0; frame < frames; frame++)
+                clusters.update(eye, view, projection, 0.1f, 100.0f);
+            std::chrono::duration<double, std::milli> assign = std::chrono::steady_clock::now() - start;
+            // the cell lists are only rebuilt when the camera changes block, this times a full rebuild
+            start = std::chrono::steady_clock::now();
+            grid.build(maze, clusters, rect);
+            std::chrono::duration<double, std::milli> floodFill = std::chrono::steady_clock::now() - start;
+            clusters.fillFrameData(frameData, viewport[2], viewport[3]);
+            grid.fillFrameData(frameData);
+            frameBuffer.update(&frameData);
+            clusters.bind();
+            grid.bind();
+
+            double cellsMs = drawTime(cells);
+            double clusteredMs = drawTime(clustered);
+            unclustered.use();
+            unclustered.setInt("lightCount", (int)count);
+            double unclusteredMs = drawTime(unclustered);
+            std::cout << count << " | " << grid.indexCount() << " | " << floodFill.count() << " | " << clusters.indexCount() << " | "
+                      << assign.count() / frames << " | " << cellsMs << " | " << clusteredMs << " | " << unclusteredMs << std::endl;
+        }
+
+        glDeleteProgram(cells.ID);
+        glDeleteProgram(clustered.ID);
+        glDeleteProgram(unclustered.ID);
+        timer.release();
+        clusters.release();
+        grid.release();
+        frameBuffer.release();
+        mesh.release();
+    }
+
+
+    // Frame time of the forward and the deferred path on the maze around its centre: walls, floor and lighting, for
+    // the five lanterns of the stock map and for a lantern every 8, 4 and 2 cells, seen from a corridor and from
+    // above. Run it on the stock map and on a large --generate maze. The material layers are 1x1 and white.
+    inline void benchmarkRenderers(const Maze &maze, MazeMeshMode mode, unsigned int frames = 100) {
+        // the open cell closest to the centre, and the direction along which the corridor from it is longest
+        int cx = maze.width / 2, cz = maze.height / 2;
+        for (int r = 0; r < std::max(maze.width, maze.height) && maze.isWall(cx, cz); r++) {
+            for (int dz = -r; dz <= r && maze.isWall(cx, cz); dz++) {
+                for (int dx = -r; dx <= r; dx++) {
+                    if (!maze.isWall(maze.width / 2 + dx, maze.height / 2 + dz)) {
+                        cx = maze.width / 2 + dx;
+                        cz = maze.height / 2 + dz;
+                        break;
+                    }
+                }
+            }
+        }
+        glm::vec3 corridor(1.0f, 0.0f, 0.0f);
+        int longest = -1;
+        for (glm::vec3 direction : {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)}) {
+            int length = 0;
+            while (length < 100 && !maze.isWall(cx + (int)direction.x * (length + 1), cz + (int)direction.z * (length + 1)))
+                length++;
+            if (length > longest) {
+                longest = length;
+                corridor = direction;
+            }
+        }
+
+        MazeRect rect{std::max(cx - 100, 0), std::max(cz - 100, 0), std::min(cx + 100, maze.width), std::min(cz + 100, maze.height)};
+        MazeMesh mesh;
+        mesh.upload(buildMazeMesh(maze, mode, rect));
+
+        unsigned int white;
+        std::vector<unsigned char> texels(MAZE_TEXTURE_LAYER_COUNT * 4, 255);
+        glGenTextures(1, &white);
+        glActiveTexture(GL_TEXTURE0 + MAZE_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, white);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, MAZE_TEXTURE_LAYER_COUNT, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glActiveTexture(GL_TEXTURE0);
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)viewport[2] / (float)std::max(viewport[3], 1), 0.1f, 100.0f);
+        UniformBuffer frameBuffer;
+        frameBuffer.create(sizeof(FrameData), FRAME_DATA_BINDING);
+        LightClusters clusters;
+        clusters.create();
+        LightGrid grid;
+        grid.create();
+        GpuTimer timer;
+        timer.create();
+
+        std::string defines = normalMatrixDefines(NORMALS_TRANSLATION_ONLY) + lightCullingDefines(LIGHT_CULLING_CELLS);
+        Shader mazeShader("resources/shaders/maze.vs", "resources/shaders/maze.fs", defines);
+        mazeShader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+        mazeShader.use();
+        mazeShader.setMat4("model", glm::mat4(1.0f));
+        mazeShader.setInt("mazeTextures", MAZE_TEXTURE_UNIT);
+        mazeShader.setInt("lightData", LIGHT_DATA_UNIT);
+        mazeShader.setInt("cellLightGrid", CELL_GRID_UNIT);
+        mazeShader.setInt("cellLightIndices", CELL_INDEX_UNIT);
+        setMazeLighting(mazeShader);
+        DeferredRenderer deferred(defines);
+        deferred.create(MAZE_TEXTURE_UNIT);
+
+        std::vector<std::pair<std::string, std::vector<glm::vec3>>> lightSets;
+        std::vector<glm::vec3> stock;
+        for (int i = 0; i < 5; i++)
+            stock.push_back(glm::vec3(0.58f + 4 * i, 1.0f, 1.0f + 4 * i));
+        lightSets.push_back(std::make_pair(std::string("stock"), stock));
+        for (int spacing : {8, 4, 2})
+            lightSets.push_back(std::make_pair("every " + std::to_string(spacing), placeLanterns(maze, spacing)));
+
+        glm::vec3 center(cx, 1.0f, cz);
+        std::pair<const char *, glm::mat4> views[2] = {
+                std::make_pair("corridor", glm::lookAt(center, center + corridor, glm::vec3(0.0f, 1.0f, 0.0f))),
+                std::make_pair("above", glm::lookAt(center + glm::vec3(0.0f, 40.0f, 30.0f), center, glm::vec3(0.0f, 1.0f, 0.0f)))};
+
+        std::cout << rect.width() << "x" << rect.height() << " cells around (" << cx << ", " << cz << "), " << frames << " frames, gpu ms per frame\n"
+                  << "view | lanterns | in reach | forward | deferred | light volumes" << std::endl;
+        for (const auto &lightSet : lightSets) {
+            clusters.setLights(lightSet.second, glm::vec3(1.0f, 0.22f, 0.20f));
+            for (const auto &view : views) {
+                glm::vec3 eye = glm::vec3(glm::inverse(view.second)[3]);
+                FrameData frameData;
+                frameData.projection = projection;
+                frameData.view = view.second;
+                frameData.viewPos = glm::vec4(eye, 1.0f);
+                frameData.spotPosition = frameData.viewPos;
+                frameData.viewFront = glm::vec4(-glm::vec3(view.second[0][2], view.second[1][2], view.second[2][2]), 0.0f);
+                grid.invalidate();
+                grid.update(maze, clusters, eye, 100.0f);
+                clusters.fillFrameData(frameData, viewport[2], viewport[3]);
+                grid.fillFrameData(frameData);
+                frameBuffer.update(&frameData);
+                Frustum frustum = Frustum::fromMatrix(projection * view.second);
+
+                auto frameTime = [&](bool useDeferred) {
+                    double total = 0.0;
+                    // the first frame includes the driver finishing the programs
+                    for (unsigned int frame = 0; frame <= frames; frame++) {
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        clusters.bind();
+                        grid.bind();
+                        timer.begin();
+                        if (useDeferred && deferred.beginGeometry(viewport[2], viewport[3])) {
+                            deferred.mazeShader.use();
+                            mesh.Draw();
+                            deferred.light(clusters, eye, 100.0f, frustum, projection, view.second);
+                        } else {
+                            mazeShader.use();
+                            mesh.Draw();
+                        }
+                        timer.end();
+                        double ms = timer.finish();
+                        if (frame > 0)
+                            total += ms;
+                    }
+                    return total / frames;
+                };
+                double forwardMs = frameTime(false);
+                double deferredMs = frameTime(true);
+                std::cout << view.first << " | " << lightSet.second.size() << " | " << grid.nearbyCount() << " | "
+                          << forwardMs << " | " << deferredMs << " | " << deferred.lightVolumeCount() << std::endl;
+            }
+        }
+
+        deferred.release();
+        glDeleteProgram(mazeShader.ID);
+        glDeleteTextures(1, &white);
+        timer.release();
+        grid.release();
+        clusters.release();
+        frameBuffer.release();
+        mesh.release();
+    }
+
+    // a uv sphere as a Wavefront file, the large model of benchmarkModels; kept when it exists so its mesh cache
+    // file stays valid between runs
+    inline void writeSphereObj(const std::string &path, unsigned int rings, unsigned int segments) {
+        std::ifstream existing(path);
+        if (existing)
+            return;
+        std::ofstream file(path);
+        const float pi = 3.14159265f;
+        for (unsigned int r = 0; r <= rings; r++) {
+            float theta = pi * r / rings;
+            for (unsigned int s = 0; s <= segments; s++) {
+                float phi = 2.0f * pi * s / segments;
+                glm::vec3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+                file << "v " << n.x << ' ' << n.y << ' ' << n.z << "\n"
+                     << "vn " << n.x << ' ' << n.y << ' ' << n.z << "\n"
+                     << "vt " << (float)s / segments << ' ' << (float)r / rings << "\n";
+            }
+        }
+        for (unsigned int r = 0; r < rings; r++) {
+            for (unsigned int s = 0; s < segments; s++) {
+                unsigned int a = r * (segments + 1) + s + 1, b = a + segments + 1;
+                file << "f " << a << '/' << a << '/' << a << ' ' << b << '/' << b << '/' << b << ' ' << a + 1 << '/' << a + 1 << '/' << a + 1 << "\n"
+                     << "f " << a + 1 << '/' << a + 1 << '/' << a + 1 << ' ' << b << '/' << b << '/' << b << ' ' << b + 1 << '/' << b + 1 << '/' << b + 1 << "\n";
+            }
+        }
+        if (!file)
+            std::cout << "ERROR::BENCHMARK::WRITE_FAILED " << path << std::endl;
+    }
+
+    // one way of loading a model in benchmarkModels, best time of the runs
+    struct ModelLoadResult {
+        double ms = 1e30;
+        bool cached = false;
+        std::size_t triangles = 0;
+        std::size_t dataBytes = 0;          // CPU vertices and indices of all meshes after the build
+        AllocationCount allocations = {0, 0};
+        AllocationCount drawAllocations = {0, 0};  // of one Draw of the loaded model
+    };
+
+    // Startup time of each model through Assimp, through Assimp plus writing the mesh cache file, from that file
+    // with float vertices kept on the CPU and from the packed file the game loads (MESH_RETAIN_NONE,
+    // MESH_FORMAT_PACKED), best of runs. The textures decode on a worker thread and are not part of the times. With
+    // RG_ALLOCATION_STATS the heap use of building the meshes is checked as well: the vertex and index data should be
+    // allocated once, more than that means a copy crept back into the Model/Mesh pipeline and false is returned.
+    // So is a Draw that allocates, the render loop draws the lanterns every frame.
+    inline bool benchmarkModels(const std::vector<std::string> &paths, const std::string &cacheDir, unsigned int runs = 5) {
+        TextureLoader textures(1, false);
+        FrameData frameData;
+        frameData.projection = glm::mat4(1.0f);
+        frameData.view = glm::mat4(1.0f);
+        UniformBuffer frameBuffer;
+        frameBuffer.create(sizeof(FrameData), FRAME_DATA_BINDING, &frameData);
+        Shader floatShader("resources/shaders/model.vs", "resources/shaders/gbuffer.fs", "#define UNLIT\n" + meshFormatDefines(MESH_FORMAT_FLOAT));
+        Shader packedShader("resources/shaders/model.vs", "resources/shaders/gbuffer.fs", "#define UNLIT\n" + meshFormatDefines(MESH_FORMAT_PACKED));
+        for (Shader *shader : {&floatShader, &packedShader})
+            shader->bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+        auto timeLoad = [&](const std::string &path, const std::string &dir, bool removeCache, MeshFormat format) {
+            MeshRetention retention = format == MESH_FORMAT_PACKED ? MESH_RETAIN_NONE : MESH_RETAIN_ALL;
+            ModelLoadResult result;
+            for (unsigned int run = 0; run < runs; run++) {
+                if (removeCache)
+                    std::remove(meshCachePath(cacheDir, Model::cacheKey(path, retention, format, MESH_OPTIMIZE_NONE)).c_str());
+                glFinish();
+                auto start = std::chrono::steady_clock::now();
+                Model model(path, false, &textures, dir, retention, format);
+                glFinish();
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                result.ms = std::min(result.ms, elapsed.count());
+                result.cached = model.cached;
+                result.allocations = model.meshAllocations;
+                result.triangles = 0;
+                for (const Mesh &mesh : model.meshes) {
+                    result.triangles += mesh.indexCount / 3;
+                }
+                result.dataBytes = model.importedCpuBytes;
+                // the first Draw sets the samplers, the second one is what every frame does
+                Shader &shader = format == MESH_FORMAT_PACKED ? packedShader : floatShader;
+                shader.use();
+                model.Draw(shader);
+                AllocationCount before = threadAllocations();
+                model.Draw(shader);
+                result.drawAllocations = threadAllocations() - before;
+                model.release();
+                textures.finish();
+                for (const Texture &texture : model.textures_loaded)
+                    glDeleteTextures(1, &texture.id);
+            }
+            return result;
+        };
+        bool passed = true;
+        for (const std::string &path : paths) {
+            ModelLoadResult assimp = timeLoad(path, "", false, MESH_FORMAT_FLOAT);
+            ModelLoadResult write = timeLoad(path, cacheDir, true, MESH_FORMAT_FLOAT);
+            ModelLoadResult read = timeLoad(path, cacheDir, false, MESH_FORMAT_FLOAT);
+            timeLoad(path, cacheDir, true, MESH_FORMAT_PACKED);
+            ModelLoadResult packed = timeLoad(path, cacheDir, false, MESH_FORMAT_PACKED);
+            std::string name = path.substr(path.find_last_of('/') + 1);
+            std::cout << name << ": " << assimp.triangles << " triangles, assimp " << assimp.ms << " ms, assimp + cache write "
+                      << write.ms << " ms, mesh cache " << read.ms << " ms" << (read.cached ? "" : " (not cached)")
+                      << ", packed mesh cache " << packed.ms << " ms" << (packed.cached ? "" : " (not cached)") << std::endl;
+#ifdef RG_ALLOCATION_STATS
+            std::cout << "  mesh build " << assimp.allocations.allocations << " allocations, " << assimp.allocations.bytes / 1024
+                      << " KB for " << assimp.dataBytes / 1024 << " KB of vertices and indices; from the cache "
+                      << read.allocations.allocations << " allocations, " << read.allocations.bytes / 1024 << " KB" << std::endl;
+            // one allocation of the data plus textures and bookkeeping; a copy of the vertices doubles it
+            if (assimp.allocations.bytes > assimp.dataBytes + assimp.dataBytes / 4 + 64 * 1024) {
+                std::cout << "ERROR::BENCHMARK::MESH_COPIES " << name << std::endl;
+                passed = false;
+            }
+            for (const ModelLoadResult *result : {&read, &packed}) {
+                if (result->drawAllocations.allocations != 0) {
+                    std::cout << "ERROR::BENCHMARK::DRAW_ALLOCATES " << name << " " << result->drawAllocations.allocations
+                              << " allocations" << std::endl;
+                    passed = false;
+                }
+            }
+#endif
+        }
+#ifndef RG_ALLOCATION_STATS
+        std::cout << "heap use not counted, configure with -DRG_ALLOCATION_STATS=ON to check the mesh build for copies" << std::endl;
+#endif
+        return passed;
+    }
+
+    // GPU time of the vertex stage of model.vs for each model in the float and the packed vertex format, drawn
+    // copies times per frame with the rasterizer off, next to the bytes of the vertex buffers it reads. Linked with
+    // the G-buffer program of the deferred renderer, which reads every attribute, so none of them is optimised out.
+    inline void benchmarkVertexFormats(const std::vector<std::string> &paths, unsigned int frames = 100, unsigned int copies = 100) {
+        FrameData frameData;
+        frameData.projection = glm::mat4(1.0f);
+        frameData.view = glm::mat4(1.0f);
+        UniformBuffer frameBuffer;
+        frameBuffer.create(sizeof(FrameData), FRAME_DATA_BINDING, &frameData);
+        GpuTimer timer;
+        timer.create();
+        glEnable(GL_RASTERIZER_DISCARD);
+
+        for (const std::string &path : paths) {
+            std::cout << path.substr(path.find_last_of('/') + 1) << ", " << copies << " copies over " << frames << " frames:\n";
+            for (MeshFormat format : {MESH_FORMAT_FLOAT, MESH_FORMAT_PACKED}) {
+                Model model(path, false, nullptr, "", MESH_RETAIN_NONE, format);
+                Shader shader("resources/shaders/model.vs", "resources/shaders/gbuffer.fs", "#define UNLIT\n" + meshFormatDefines(format));
+                shader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+                shader.use();
+                shader.setMat4("model", glm::mat4(1.0f));
+
+                // the first frame includes the driver finishing the program
+                model.Draw(shader);
+                double total = 0.0;
+                for (unsigned int frame = 0; frame < frames; frame++) {
+                    timer.begin();
+                    for (unsigned int copy = 0; copy < copies; copy++)
+                        model.Draw(shader);
+                    timer.end();
+                    total += timer.finish();
+                }
+                std::size_t indexBytes = 0;
+                for (const Mesh &mesh : model.meshes)
+                    indexBytes += (std::size_t)mesh.indexCount * sizeof(unsigned int);
+                std::cout << "  " << (format == MESH_FORMAT_PACKED ? "packed" : "float ") << ": " << total / frames << " ms, "
+                          << (model.gpuBytes() - indexBytes) / 1024 << " KB of vertices" << std::endl;
+                glDeleteProgram(shader.ID);
+                model.release();
+                for (const Texture &texture : model.textures_loaded)
+                    glDeleteTextures(1, &texture.id);
+            }
+        }
+
+        glDisable(GL_RASTERIZER_DISCARD);
+        timer.release();
+        frameBuffer.release();
+    }
+
+};
+#endif //PROJECT_BASE_BENCHMARK_H
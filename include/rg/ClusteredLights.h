@@ -0,0 +1,367 @@
+//
+// Created by bambino on 22.2.21..
+//
+
+#ifndef PROJECT_BASE_CLUSTEREDLIGHTS_H
+#define PROJECT_BASE_CLUSTEREDLIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/Maze.h>
+#include <rg/UniformBuffer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace rg {
+
+    // cluster grid, keep in sync with resources/shaders/lights.glsl
+    const int CLUSTER_TILES_X = 16;
+    const int CLUSTER_TILES_Y = 9;
+    const int CLUSTER_SLICES = 24;
+    const int CLUSTER_COUNT = CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES;
+
+    // texture units of the light buffers, above the ones used by the materials
+    const int LIGHT_DATA_UNIT = 5;
+    const int CLUSTER_GRID_UNIT = 6;
+    const int LIGHT_INDEX_UNIT = 7;
+    const int CELL_GRID_UNIT = 8;
+    const int CELL_INDEX_UNIT = 9;
+
+    // the lantern attenuation is faded to zero at this distance so a light only touches nearby clusters
+    const float LANTERN_LIGHT_RADIUS = 8.0f;
+
+    // buffer object seen by the shaders as a samplerBuffer
+    struct TextureBuffer {
+        unsigned int buffer = 0;
+        unsigned int texture = 0;
+
+        void create(GLenum format) {
+            glGenBuffers(1, &buffer);
+            glGenTextures(1, &texture);
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        // replaces the whole storage, which also lets the driver orphan the copy still in use by the GPU
+        void upload(const void *data, size_t bytes, GLenum usage) {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(bytes, 16), data, usage);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        void bind(int unit) const {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+        }
+
+        void release() {
+            if (buffer) {
+                glDeleteBuffers(1, &buffer);
+                glDeleteTextures(1, &texture);
+            }
+            buffer = texture = 0;
+        }
+    };
+
+    // a lantern on the first open cell of every spacing x spacing block of the maze
+    inline std::vector<glm::vec3> placeLanterns(const Maze &maze, int spacing, float height = 1.0f) {
+        std::vector<glm::vec3> positions;
+        spacing = std::max(spacing, 1);
+        for (int z0 = 0; z0 < maze.height; z0 += spacing) {
+            for (int x0 = 0; x0 < maze.width; x0 += spacing) {
+                bool placed = false;
+                for (int z = z0; z < std::min(z0 + spacing, maze.height) && !placed; z++) {
+                    for (int x = x0; x < std::min(x0 + spacing, maze.width) && !placed; x++) {
+                        if (!maze.isWall(x, z)) {
+                            positions.push_back(glm::vec3(x, height, z));
+                            placed = true;
+                        }
+                    }
+                }
+            }
+        }
+        return positions;
+    }
+
+    // Clustered forward lighting: the view frustum is split into CLUSTER_TILES_X x CLUSTER_TILES_Y screen tiles and
+    // CLUSTER_SLICES exponential depth slices. Every frame the lights near the camera are assigned to the clusters their
+    // sphere touches, and the fragment shaders only loop over the lights of their own cluster.
+    class LightClusters {
+    public:
+        void create() {
+            GLint maxTexels = 0;
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+            maxIndices = (unsigned int)maxTexels;
+            lightData.create(GL_RGBA32F);
+            clusterGrid.create(GL_RG32UI);
+            lightIndices.create(GL_R32UI);
+        }
+
+        void release() {
+            lightData.release();
+            clusterGrid.release();
+            lightIndices.release();
+        }
+
+        // the lanterns never move, so their data is uploaded once; lights are bucketed by cell for the per-frame query
+        void setLights(const std::vector<glm::vec3> &lightPositions, const glm::vec3 &attenuation, float radius = LANTERN_LIGHT_RADIUS) {
+            positions = lightPositions;
+            this->radius = radius;
+            std::vector<glm::vec4> texels;
+            texels.reserve(positions.size() * 2);
+            for (const glm::vec3 &position : positions) {
+                texels.push_back(glm::vec4(position, radius));
+                texels.push_back(glm::vec4(attenuation, 0.0f));
+            }
+            lightData.upload(texels.data(), texels.size() * sizeof(glm::vec4), GL_STATIC_DRAW);
+
+            bucketsX = bucketsZ = 1;
+            for (const glm::vec3 &position : positions) {
+                bucketsX = std::max(bucketsX, (int)std::floor(position.x / BUCKET_SIZE) + 1);
+                bucketsZ = std::max(bucketsZ, (int)std::floor(position.z / BUCKET_SIZE) + 1);
+            }
+            bucketStart.assign(bucketsX * bucketsZ + 1, 0);
+            for (const glm::vec3 &position : positions)
+                bucketStart[bucketOf(position) + 1]++;
+            for (size_t i = 1; i < bucketStart.size(); i++)
+                bucketStart[i] += bucketStart[i - 1];
+            bucketLights.assign(positions.size(), 0);
+            std::vector<unsigned int> fill(bucketStart.begin(), bucketStart.end() - 1);
+            for (unsigned int i = 0; i < positions.size(); i++)
+                bucketLights[fill[bucketOf(positions[i])]++] = i;
+        }
+
+        // indices of the lights whose centre is within distance of position in the xz plane
+        void gatherNearby(const glm::vec3 &position, float distance, std::vector<unsigned int> &out) const {
+            out.clear();
+            if (positions.empty())
+                return;
+            // lights outside of the bucket grid were put into the border buckets, so the range is clamped the same way
+            int bx0 = bucketX(position.x - distance), bx1 = bucketX(position.x + distance);
+            int bz0 = bucketZ(position.z - distance), bz1 = bucketZ(position.z + distance);
+            for (int bz = bz0; bz <= bz1; bz++) {
+                for (int bx = bx0; bx <= bx1; bx++) {
+                    int bucket = bz * bucketsX + bx;
+                    for (unsigned int i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++) {
+                        const glm::vec3 &light = positions[bucketLights[i]];
+                        float dx = light.x - position.x, dz = light.z - position.z;
+                        if (dx * dx + dz * dz <= distance * distance)
+                            out.push_back(bucketLights[i]);
+                    }
+                }
+            }
+        }
+
+        // assigns the lights to the clusters of this frame's camera and uploads the grid and the index list
+        void update(const glm::vec3 &cameraPos, const glm::mat4 &view, const glm::mat4 &projection, float near, float far) {
+            if (projection[0][0] != projectionX || projection[1][1] != projectionY || near != this->near || far != this->far)
+                buildClusterBounds(projection[0][0], projection[1][1], near, far);
+
+            // the far corners of the frustum are further away than far
+            float reach = far * std::sqrt(1.0f + 1.0f / (projectionX * projectionX) + 1.0f / (projectionY * projectionY));
+            gatherNearby(cameraPos, reach + radius, nearby);
+            pairs.clear();
+            for (unsigned int light : nearby)
+                assign(light, glm::vec3(view * glm::vec4(positions[light], 1.0f)));
+
+            // counting sort of the (cluster, light) pairs into one index list
+            counts.assign(CLUSTER_COUNT * 2, 0);
+            for (const auto &pair : pairs)
+                counts[pair.first * 2 + 1]++;
+            unsigned int offset = 0;
+            for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+                counts[cluster * 2] = offset;
+                offset += counts[cluster * 2 + 1];
+            }
+            indices.resize(pairs.size());
+            fill.assign(CLUSTER_COUNT, 0);
+            for (const auto &pair : pairs)
+                indices[counts[pair.first * 2] + fill[pair.first]++] = pair.second;
+
+            // a larger list than the driver's buffer texture limit would read garbage, so the tail clusters lose lights
+            overflow = 0;
+            if (indices.size() > maxIndices) {
+                overflow = indices.size() - maxIndices;
+                indices.resize(maxIndices);
+                for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+                    unsigned int start = std::min(counts[cluster * 2], maxIndices);
+                    counts[cluster * 2] = start;
+                    counts[cluster * 2 + 1] = std::min(counts[cluster * 2 + 1], maxIndices - start);
+                }
+            }
+
+            clusterGrid.upload(counts.data(), counts.size() * sizeof(unsigned int), GL_STREAM_DRAW);
+            lightIndices.upload(indices.data(), indices.size() * sizeof(unsigned int), GL_STREAM_DRAW);
+        }
+
+        // cluster lookup constants of FrameData for a framebuffer of width x height pixels
+        void fillFrameData(FrameData &frameData, int width, int height) const {
+            float logRatio = std::log(far / near);
+            frameData.clusterParams = glm::vec4((float)CLUSTER_TILES_X / std::max(width, 1), (float)CLUSTER_TILES_Y / std::max(height, 1),
+                                                CLUSTER_SLICES / logRatio, -CLUSTER_SLICES * std::log(near) / logRatio);
+        }
+
+        void bind() const {
+            lightData.bind(LIGHT_DATA_UNIT);
+            clusterGrid.bind(CLUSTER_GRID_UNIT);
+            lightIndices.bind(LIGHT_INDEX_UNIT);
+        }
+
+        unsigned int lightCount() const {
+            return positions.size();
+        }
+
+        const glm::vec3 &lightPosition(unsigned int light) const {
+            return positions[light];
+        }
+
+        float lightRadius() const {
+            return radius;
+        }
+
+        // lights near enough to be assigned this frame
+        unsigned int nearbyCount() const {
+            return nearby.size();
+        }
+
+        // entries in the cluster index list, i.e. the sum of lights over all clusters
+        unsigned int indexCount() const {
+            return indices.size();
+        }
+
+        unsigned int overflowCount() const {
+            return overflow;
+        }
+
+    private:
+        static constexpr float BUCKET_SIZE = 16.0f;
+
+        struct Bounds {
+            glm::vec3 min, max;
+        };
+
+        TextureBuffer lightData;     // two texels per light: position and radius, attenuation
+        TextureBuffer clusterGrid;   // offset into lightIndices and light count per cluster
+        TextureBuffer lightIndices;
+        unsigned int maxIndices = 65536;
+
+        std::vector<glm::vec3> positions;
+        float radius = LANTERN_LIGHT_RADIUS;
+        int bucketsX = 0, bucketsZ = 0;
+        std::vector<unsigned int> bucketStart;
+        std::vector<unsigned int> bucketLights;
+
+        // view space bounds of every cluster, rebuilt when the projection changes
+        std::vector<Bounds> clusterBounds;
+        float projectionX = 0.0f, projectionY = 0.0f, near = 0.1f, far = 100.0f;
+
+        // per frame, kept to avoid reallocating
+        std::vector<unsigned int> nearby;
+        std::vector<std::pair<unsigned int, unsigned int>> pairs;
+        std::vector<unsigned int> counts;
+        std::vector<unsigned int> fill;
+        std::vector<unsigned int> indices;
+        unsigned int overflow = 0;
+
+        int bucketX(float x) const {
+            return std::min(std::max((int)std::floor(x / BUCKET_SIZE), 0), bucketsX - 1);
+        }
+
+        int bucketZ(float z) const {
+            return std::min(std::max((int)std::floor(z / BUCKET_SIZE), 0), bucketsZ - 1);
+        }
+
+        int bucketOf(const glm::vec3 &position) const {
+            return bucketZ(position.z) * bucketsX + bucketX(position.x);
+        }
+
+        float sliceDepth(int slice) const {
+            return near * std::pow(far / near, (float)slice / CLUSTER_SLICES);
+        }
+
+        int sliceOf(float depth) const {
+            int slice = (int)std::floor(std::log(depth / near) / std::log(far / near) * CLUSTER_SLICES);
+            return std::min(std::max(slice, 0), CLUSTER_SLICES - 1);
+        }
+
+        void buildClusterBounds(float px, float py, float near, float far) {
+            projectionX = px;
+            projectionY = py;
+            this->near = near;
+            this->far = far;
+            clusterBounds.resize(CLUSTER_COUNT);
+            for (int slice = 0; slice < CLUSTER_SLICES; slice++) {
+                float depths[2] = {sliceDepth(slice), sliceDepth(slice + 1)};
+                for (int ty = 0; ty < CLUSTER_TILES_Y; ty++) {
+                    for (int tx = 0; tx < CLUSTER_TILES_X; tx++) {
+                        float ndcX[2] = {-1.0f + 2.0f * tx / CLUSTER_TILES_X, -1.0f + 2.0f * (tx + 1) / CLUSTER_TILES_X};
+                        float ndcY[2] = {-1.0f + 2.0f * ty / CLUSTER_TILES_Y, -1.0f + 2.0f * (ty + 1) / CLUSTER_TILES_Y};
+                        Bounds bounds{glm::vec3(1e30f), glm::vec3(-1e30f)};
+                        // the eight corners of the cluster, view space looks down -z
+                        for (float depth : depths) {
+                            for (float x : ndcX) {
+                                for (float y : ndcY) {
+                                    glm::vec3 corner(x * depth / px, y * depth / py, -depth);
+                                    bounds.min = glm::min(bounds.min, corner);
+                                    bounds.max = glm::max(bounds.max, corner);
+                                }
+                            }
+                        }
+                        clusterBounds[(slice * CLUSTER_TILES_Y + ty) * CLUSTER_TILES_X + tx] = bounds;
+                    }
+                }
+            }
+        }
+
+        // adds (cluster, light) for every cluster the light sphere touches, center is in view space
+        void assign(unsigned int light, const glm::vec3 &center) {
+            float depth = -center.z;
+            if (depth + radius < near || depth - radius > far)
+                return;
+            int slice0 = sliceOf(std::max(depth - radius, near));
+            int slice1 = sliceOf(std::min(depth + radius, far));
+
+            // screen rectangle of the sphere's box, the whole screen when the sphere reaches behind the near plane
+            int tx0 = 0, ty0 = 0, tx1 = CLUSTER_TILES_X - 1, ty1 = CLUSTER_TILES_Y - 1;
+            if (depth - radius > near) {
+                float minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f;
+                for (float d : {depth - radius, depth + radius}) {
+                    for (float sign : {-1.0f, 1.0f}) {
+                        float x = projectionX * (center.x + sign * radius) / d;
+                        float y = projectionY * (center.y + sign * radius) / d;
+                        minX = std::min(minX, x); maxX = std::max(maxX, x);
+                        minY = std::min(minY, y); maxY = std::max(maxY, y);
+                    }
+                }
+                if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f)
+                    return;
+                tx0 = std::max(0, (int)std::floor((minX + 1.0f) * 0.5f * CLUSTER_TILES_X));
+                tx1 = std::min(CLUSTER_TILES_X - 1, (int)std::floor((maxX + 1.0f) * 0.5f * CLUSTER_TILES_X));
+                ty0 = std::max(0, (int)std::floor((minY + 1.0f) * 0.5f * CLUSTER_TILES_Y));
+                ty1 = std::min(CLUSTER_TILES_Y - 1, (int)std::floor((maxY + 1.0f) * 0.5f * CLUSTER_TILES_Y));
+            }
+
+            for (int slice = slice0; slice <= slice1; slice++) {
+                for (int ty = ty0; ty <= ty1; ty++) {
+                    for (int tx = tx0; tx <= tx1; tx++) {
+                        int cluster = (slice * CLUSTER_TILES_Y + ty) * CLUSTER_TILES_X + tx;
+                        const Bounds &bounds = clusterBounds[cluster];
+                        glm::vec3 closest = glm::clamp(center, bounds.min, bounds.max);
+                        glm::vec3 delta = closest - center;
+                        if (glm::dot(delta, delta) <= radius * radius)
+                            pairs.emplace_back(cluster, light);
+                    }
+                }
+            }
+        }
+    };
+
+};
+#endif //PROJECT_BASE_CLUSTEREDLIGHTS_H
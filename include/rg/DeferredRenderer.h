@@ -0,0 +1,272 @@
+//
+// Created by bambino on 24.2.21..
+//
+
+#ifndef PROJECT_BASE_DEFERREDRENDERER_H
+#define PROJECT_BASE_DEFERREDRENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <rg/ClusteredLights.h>
+#include <rg/FrameStats.h>
+#include <rg/Frustum.h>
+#include <rg/GBuffer.h>
+#include <rg/LightGrid.h>
+#include <rg/Lightmap.h>
+#include <rg/ShadowMaps.h>
+#include <rg/SurfaceLighting.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+    // how the maze is lit, see --renderer
+    enum RenderPath {
+        RENDER_FORWARD,     // every fragment of maze.fs loops over its lights
+        RENDER_DEFERRED     // G-buffer pass, then one lighting pass per light volume (DeferredRenderer)
+    };
+
+    // Deferred shading: the maze and the lanterns write their surface to a GBuffer once, then the spot light is
+    // applied in one full screen pass and every lantern adds its light to the pixels inside its sphere. The cost of
+    // a light no longer grows with overdraw, and the lighting code runs once per pixel instead of once per fragment.
+    class DeferredRenderer {
+    public:
+        // programs writing the G-buffer, the caller binds the maze texture array and draws with them
+        Shader mazeShader;
+        Shader modelShader;
+
+        // defines carries the normal matrix variant of maze.vs and the light culling mode, modelDefines the vertex
+        // format of the lanterns (meshFormatDefines)
+        explicit DeferredRenderer(const std::string &defines, const std::string &modelDefines = "")
+                : mazeShader("resources/shaders/maze.vs", "resources/shaders/gbuffer.fs", defines),
+                  modelShader("resources/shaders/model.vs", "resources/shaders/gbuffer.fs", "#define UNLIT\n" + modelDefines),
+                  spotShader("resources/shaders/fullscreen.vs", "resources/shaders/deferred_spot.fs", defines),
+                  volumeShader("resources/shaders/light_volume.vs", "resources/shaders/light_volume.fs", defines) {
+        }
+
+        // mazeTextureUnit is the unit the maze texture array is bound to while drawing
+        void create(int mazeTextureUnit) {
+            for (const Shader *shader : {&mazeShader, &modelShader, &spotShader, &volumeShader})
+                shader->bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+            mazeShader.use();
+            mazeShader.setInt("mazeTextures", mazeTextureUnit);
+            modelShader.use();
+            modelShader.setInt("materialId", MATERIAL_UNLIT);
+            for (const Shader *shader : {&spotShader, &volumeShader}) {
+                shader->use();
+                shader->setInt("gNormal", GBUFFER_NORMAL_UNIT);
+                shader->setInt("gAlbedo", GBUFFER_ALBEDO_UNIT);
+                shader->setInt("gSpecular", GBUFFER_SPECULAR_UNIT);
+                shader->setInt("gDepth", GBUFFER_DEPTH_UNIT);
+                shader->setInt("lightData", LIGHT_DATA_UNIT);
+                shader->setInt("clusterGrid", CLUSTER_GRID_UNIT);
+                shader->setInt("lightIndices", LIGHT_INDEX_UNIT);
+                shader->setInt("cellLightGrid", CELL_GRID_UNIT);
+                shader->setInt("cellLightIndices", CELL_INDEX_UNIT);
+            }
+            setLighting(MATERIAL_WALL, WALL_LIGHTING);
+            setLighting(MATERIAL_FLOOR, FLOOR_LIGHTING);
+            createSphere();
+            glGenVertexArrays(1, &emptyVAO);
+        }
+
+        // for programs built with LIGHTMAP: the full screen pass adds the baked lantern light and the volumes are skipped
+        void useLightmap(const Lightmap &lightmap) {
+            lightmap.setUniforms(spotShader);
+            lightVolumes = false;
+        }
+
+        // for programs built with SHADOWS
+        void useShadows(const ShadowMaps &shadows) {
+            shadows.setUniforms(spotShader);
+            shadows.setUniforms(volumeShader);
+        }
+
+        void setLighting(int material, const SurfaceLighting &lighting) const {
+            setSurfaceLighting(spotShader, lighting, material);
+            setSurfaceLighting(volumeShader, lighting, material);
+        }
+
+        // binds and clears the G-buffer, sized like the framebuffer the lighting is drawn to
+        bool beginGeometry(int width, int height) {
+            if (!gBuffer.resize(width, height))
+                return false;
+            gBuffer.bindForWriting();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            // the alpha channels hold data, blending would mix them
+            glDisable(GL_BLEND);
+            return true;
+        }
+
+        // Lights the G-buffer into target: the spot light everywhere, then the volumes of the lanterns within distance
+        // of the camera that the frustum can see. Leaves target bound with the scene depth, so forward passes such as
+        // the skybox and the transparent hints can be drawn on top.
+        void light(const LightClusters &lights, const glm::vec3 &cameraPos, float distance, const Frustum &frustum,
+                   const glm::mat4 &projection, const glm::mat4 &view, unsigned int target = 0) {
+            gBuffer.blitDepth(target);
+            glClear(GL_COLOR_BUFFER_BIT);
+            gBuffer.bindTextures();
+            glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+
+            // spot light and unlit models, every pixel that has a surface once
+            glDisable(GL_DEPTH_TEST);
+            spotShader.use();
+            spotShader.setMat4("inverseViewProjection", inverseViewProjection);
+            glBindVertexArray(emptyVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            frameStats().drawCalls++;
+
+            volumeCount = 0;
+            if (lightVolumes)
+                drawLightVolumes(lights, cameraPos, distance, frustum, inverseViewProjection);
+
+            glEnable(GL_DEPTH_TEST);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glBindVertexArray(0);
+            glActiveTexture(GL_TEXTURE0);
+        }
+
+        // light volumes drawn by the last light()
+        unsigned int lightVolumeCount() const {
+            return volumeCount;
+        }
+
+        void release() {
+            gBuffer.release();
+            if (sphereVAO) {
+                glDeleteVertexArrays(1, &sphereVAO);
+                glDeleteBuffers(1, &sphereVBO);
+                glDeleteBuffers(1, &sphereEBO);
+                glDeleteBuffers(1, &instanceVBO);
+                glDeleteVertexArrays(1, &emptyVAO);
+            }
+            sphereVAO = sphereVBO = sphereEBO = instanceVBO = emptyVAO = 0;
+            for (const Shader *shader : {&mazeShader, &modelShader, &spotShader, &volumeShader})
+                glDeleteProgram(shader->ID);
+        }
+
+    private:
+        static const int SPHERE_SEGMENTS = 16;
+        static const int SPHERE_RINGS = 8;
+
+        Shader spotShader;
+        Shader volumeShader;
+        GBuffer gBuffer;
+        bool lightVolumes = true;
+
+        unsigned int sphereVAO = 0, sphereVBO = 0, sphereEBO = 0, instanceVBO = 0;
+        unsigned int sphereIndexCount = 0;
+        unsigned int emptyVAO = 0;   // core profile draws need a vertex array even without attributes
+
+        // per frame, kept to avoid reallocating
+        std::vector<unsigned int> nearby;
+        AabbBatch volumeBounds;
+        std::vector<unsigned char> volumeVisible;
+        std::vector<unsigned int> volumes;
+        unsigned int volumeCount = 0;
+
+        void drawLightVolumes(const LightClusters &lights, const glm::vec3 &cameraPos, float distance, const Frustum &frustum,
+                              const glm::mat4 &inverseViewProjection) {
+            // the lanterns whose sphere can touch a visible pixel
+            lights.gatherNearby(cameraPos, distance + lights.lightRadius(), nearby);
+            volumeBounds.clear();
+            glm::vec3 extent(lights.lightRadius());
+            for (unsigned int light : nearby)
+                volumeBounds.add(lights.lightPosition(light) - extent, lights.lightPosition(light) + extent);
+            frustum.cullBoxes(volumeBounds, volumeVisible);
+            volumes.clear();
+            for (unsigned int i = 0; i < nearby.size(); i++) {
+                if (volumeVisible[i])
+                    volumes.push_back(nearby[i]);
+            }
+            volumeCount = volumes.size();
+
+            if (!volumes.empty()) {
+                glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+                glBufferData(GL_ARRAY_BUFFER, volumes.size() * sizeof(unsigned int), volumes.data(), GL_STREAM_DRAW);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+                // back faces behind the stored depth, so a pixel is lit once whether or not the camera is inside the
+                // sphere; depth clamp keeps the back faces that reach past the far plane
+                glEnable(GL_DEPTH_TEST);
+                glDepthFunc(GL_GEQUAL);
+                glDepthMask(GL_FALSE);
+                glEnable(GL_CULL_FACE);
+                glCullFace(GL_FRONT);
+                glEnable(GL_DEPTH_CLAMP);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+
+                volumeShader.use();
+                volumeShader.setMat4("inverseViewProjection", inverseViewProjection);
+                glBindVertexArray(sphereVAO);
+                glDrawElementsInstanced(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_SHORT, 0, volumes.size());
+                frameStats().drawCalls++;
+                frameStats().triangles += sphereIndexCount / 3 * volumes.size();
+
+                glDisable(GL_DEPTH_CLAMP);
+                glCullFace(GL_BACK);
+                glDisable(GL_CULL_FACE);
+                glDepthMask(GL_TRUE);
+                glDepthFunc(GL_LESS);
+            }
+        }
+
+        // Unit sphere with outward facing counter-clockwise triangles. The vertices are pushed out so the flat faces
+        // enclose the unit sphere, otherwise pixels near the edge of a light's radius would be missed.
+        void createSphere() {
+            const float pi = 3.14159265f;
+            float scale = 1.0f / (std::cos(pi / SPHERE_SEGMENTS) * std::cos(pi / (2 * SPHERE_RINGS)));
+            std::vector<glm::vec3> vertices;
+            for (int ring = 0; ring <= SPHERE_RINGS; ring++) {
+                float phi = pi * ring / SPHERE_RINGS;
+                for (int segment = 0; segment <= SPHERE_SEGMENTS; segment++) {
+                    float theta = 2.0f * pi * segment / SPHERE_SEGMENTS;
+                    vertices.push_back(scale * glm::vec3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)));
+                }
+            }
+            std::vector<unsigned short> indices;
+            for (int ring = 0; ring < SPHERE_RINGS; ring++) {
+                for (int segment = 0; segment < SPHERE_SEGMENTS; segment++) {
+                    unsigned short a = ring * (SPHERE_SEGMENTS + 1) + segment, b = a + SPHERE_SEGMENTS + 1;
+                    if (ring != 0) {
+                        indices.push_back(a);
+                        indices.push_back(a + 1);
+                        indices.push_back(b);
+                    }
+                    if (ring != SPHERE_RINGS - 1) {
+                        indices.push_back(a + 1);
+                        indices.push_back(b + 1);
+                        indices.push_back(b);
+                    }
+                }
+            }
+            sphereIndexCount = indices.size();
+
+            glGenVertexArrays(1, &sphereVAO);
+            glGenBuffers(1, &sphereVBO);
+            glGenBuffers(1, &sphereEBO);
+            glGenBuffers(1, &instanceVBO);
+            glBindVertexArray(sphereVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glEnableVertexAttribArray(1);
+            glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+            glVertexAttribDivisor(1, 1);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    };
+
+};
+#endif //PROJECT_BASE_DEFERREDRENDERER_H
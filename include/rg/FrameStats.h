@@ -0,0 +1,64 @@
+//
+// Created by bambino on 10.2.21..
+//
+
+#ifndef PROJECT_BASE_FRAMESTATS_H
+#define PROJECT_BASE_FRAMESTATS_H
+
+namespace rg {
+
+    // objects that went through frustum or occlusion culling this frame
+    struct CullStats {
+        unsigned int visible = 0;
+        unsigned int culled = 0;
+
+        void add(unsigned int tested, unsigned int visibleCount) {
+            visible += visibleCount;
+            culled += tested - visibleCount;
+        }
+    };
+
+    // per-frame counters, reset at the start of every frame and shown in the window title
+    struct FrameStats {
+        unsigned int drawCalls = 0;
+        unsigned int triangles = 0;
+        unsigned int chunks = 0;
+        unsigned int visibleCells = 0;
+        unsigned int uniformsIssued = 0;     // glUniform* calls made by Shader
+        unsigned int uniformsSkipped = 0;    // sets dropped because the uniform already had the value
+        unsigned int lights = 0;             // lights assigned to cells or clusters
+        unsigned int lightIndices = 0;       // sum of the per-cell or per-cluster light counts
+        double mazeGpuMs = 0.0;              // maze and lantern passes with their lighting, from a timer query of an earlier frame
+        double shadowGpuMs = 0.0;            // spot shadow map and new lantern shadow maps, from an earlier frame as well
+        unsigned int shadowMapsRendered = 0; // lantern shadow maps rendered this frame, cached ones are not counted
+        unsigned int shadowedLights = 0;     // lanterns near the camera that have a shadow map
+        unsigned long long litFragments = 0; // fragments of the lit wall and floor pass, from an earlier frame
+        CullStats cull;                      // frustum culling of chunks, lanterns and hints
+        CullStats occlusion;                 // chunks the frustum kept, tested against the visible cells
+
+        void reset() {
+            drawCalls = 0;
+            triangles = 0;
+            chunks = 0;
+            visibleCells = 0;
+            uniformsIssued = 0;
+            uniformsSkipped = 0;
+            lights = 0;
+            lightIndices = 0;
+            mazeGpuMs = 0.0;
+            shadowGpuMs = 0.0;
+            shadowMapsRendered = 0;
+            shadowedLights = 0;
+            litFragments = 0;
+            cull = CullStats();
+            occlusion = CullStats();
+        }
+    };
+
+    inline FrameStats& frameStats() {
+        static FrameStats stats;
+        return stats;
+    }
+
+};
+#endif //PROJECT_BASE_FRAMESTATS_H
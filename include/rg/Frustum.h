@@ -0,0 +1,103 @@
+//
+// Created by bambino on 16.2.21..
+//
+
+#ifndef PROJECT_BASE_FRUSTUM_H
+#define PROJECT_BASE_FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define RG_FRUSTUM_SSE 1
+#endif
+
+namespace rg {
+
+    // axis aligned boxes stored as structure of arrays so four of them can be tested at once
+    struct AabbBatch {
+        std::vector<float> minX, minY, minZ;
+        std::vector<float> maxX, maxY, maxZ;
+
+        void clear() {
+            minX.clear(); minY.clear(); minZ.clear();
+            maxX.clear(); maxY.clear(); maxZ.clear();
+        }
+
+        void add(const glm::vec3 &min, const glm::vec3 &max) {
+            minX.push_back(min.x); minY.push_back(min.y); minZ.push_back(min.z);
+            maxX.push_back(max.x); maxY.push_back(max.y); maxZ.push_back(max.z);
+        }
+
+        unsigned int size() const {
+            return minX.size();
+        }
+    };
+
+    class Frustum {
+    public:
+        // plane i is dot(planes[i].xyz, p) + planes[i].w >= 0 for points inside
+        glm::vec4 planes[6];
+
+        // Gribb/Hartmann extraction from the rows of projection * view
+        static Frustum fromMatrix(const glm::mat4 &m) {
+            Frustum frustum;
+            for (int i = 0; i < 3; i++) {
+                glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+                glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+                frustum.planes[2 * i] = w + row;
+                frustum.planes[2 * i + 1] = w - row;
+            }
+            for (glm::vec4 &plane : frustum.planes)
+                plane /= glm::length(glm::vec3(plane));
+            return frustum;
+        }
+
+        // a box is outside as soon as its corner furthest along some plane normal is behind that plane
+        bool isBoxVisible(const glm::vec3 &min, const glm::vec3 &max) const {
+            for (const glm::vec4 &plane : planes) {
+                glm::vec3 p(plane.x > 0.0f ? max.x : min.x, plane.y > 0.0f ? max.y : min.y, plane.z > 0.0f ? max.z : min.z);
+                if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f)
+                    return false;
+            }
+            return true;
+        }
+
+        // writes 1 for every visible box of the batch into visible and returns how many there are
+        unsigned int cullBoxes(const AabbBatch &boxes, std::vector<unsigned char> &visible) const {
+            unsigned int count = boxes.size();
+            visible.assign(count, 1);
+            unsigned int i = 0;
+#ifdef RG_FRUSTUM_SSE
+            for (; i + 4 <= count; i += 4) {
+                __m128 outside = _mm_setzero_ps();
+                for (const glm::vec4 &plane : planes) {
+                    __m128 px = _mm_loadu_ps(plane.x > 0.0f ? &boxes.maxX[i] : &boxes.minX[i]);
+                    __m128 py = _mm_loadu_ps(plane.y > 0.0f ? &boxes.maxY[i] : &boxes.minY[i]);
+                    __m128 pz = _mm_loadu_ps(plane.z > 0.0f ? &boxes.maxZ[i] : &boxes.minZ[i]);
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(plane.x)), _mm_mul_ps(py, _mm_set1_ps(plane.y))),
+                                                 _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+                }
+                int mask = _mm_movemask_ps(outside);
+                for (int lane = 0; lane < 4; lane++)
+                    visible[i + lane] = (mask & (1 << lane)) ? 0 : 1;
+            }
+#endif
+            for (; i < count; i++) {
+                visible[i] = isBoxVisible(glm::vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]),
+                                          glm::vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i])) ? 1 : 0;
+            }
+
+            unsigned int visibleCount = 0;
+            for (unsigned char v : visible)
+                visibleCount += v;
+            return visibleCount;
+        }
+    };
+
+};
+#endif //PROJECT_BASE_FRUSTUM_H
@@ -0,0 +1,110 @@
+//
+// Created by bambino on 24.2.21..
+//
+
+#ifndef PROJECT_BASE_GBUFFER_H
+#define PROJECT_BASE_GBUFFER_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+namespace rg {
+
+    // texture units the lighting passes read the G-buffer from, above the light buffers
+    const int GBUFFER_NORMAL_UNIT = 10;
+    const int GBUFFER_ALBEDO_UNIT = 11;
+    const int GBUFFER_SPECULAR_UNIT = 12;
+    const int GBUFFER_DEPTH_UNIT = 13;
+
+    // Render targets of the deferred renderer, see resources/shaders/gbuffer.glsl. The position is not stored, the
+    // lighting passes rebuild it from the depth, which keeps large maze coordinates exact without a 32 bit target.
+    class GBuffer {
+    public:
+        unsigned int FBO = 0;
+        int width = 0;
+        int height = 0;
+
+        // (re)creates the targets when the size changed, returns false when the framebuffer is unusable
+        bool resize(int width, int height) {
+            if (FBO && width == this->width && height == this->height)
+                return true;
+            release();
+            this->width = width;
+            this->height = height;
+
+            glGenFramebuffers(1, &FBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+            normal = attach(GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT0);     // world normal, material id
+            albedo = attach(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT1);    // diffuse colour
+            specular = attach(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT2);  // specular colour
+            // same format as the default framebuffer so the depth can be blitted for the forward passes after lighting
+            depth = attach(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_DEPTH_STENCIL_ATTACHMENT);
+            unsigned int attachments[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+            glDrawBuffers(3, attachments);
+
+            bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+            if (!complete)
+                std::cout << "ERROR::GBUFFER::FRAMEBUFFER_INCOMPLETE" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            return complete;
+        }
+
+        void bindForWriting() const {
+            glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+            glViewport(0, 0, width, height);
+        }
+
+        void bindTextures() const {
+            bindTexture(GBUFFER_NORMAL_UNIT, normal);
+            bindTexture(GBUFFER_ALBEDO_UNIT, albedo);
+            bindTexture(GBUFFER_SPECULAR_UNIT, specular);
+            bindTexture(GBUFFER_DEPTH_UNIT, depth);
+        }
+
+        // copies the depth into target and leaves target bound
+        void blitDepth(unsigned int target = 0) const {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, target);
+        }
+
+        void release() {
+            if (FBO) {
+                unsigned int textures[4] = {normal, albedo, specular, depth};
+                glDeleteTextures(4, textures);
+                glDeleteFramebuffers(1, &FBO);
+            }
+            FBO = normal = albedo = specular = depth = 0;
+        }
+
+    private:
+        unsigned int normal = 0;
+        unsigned int albedo = 0;
+        unsigned int specular = 0;
+        unsigned int depth = 0;
+
+        unsigned int attach(GLenum internalFormat, GLenum format, GLenum type, GLenum attachment) const {
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+            // the lighting passes read single texels
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return texture;
+        }
+
+        static void bindTexture(int unit, unsigned int texture) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D, texture);
+        }
+    };
+
+};
+#endif //PROJECT_BASE_GBUFFER_H
@@ -0,0 +1,125 @@
+//
+// Created by bambino on 21.2.21..
+//
+
+#ifndef PROJECT_BASE_GPUTIMER_H
+#define PROJECT_BASE_GPUTIMER_H
+
+#include <glad/glad.h>
+
+namespace rg {
+
+    // GPU time between begin and end from GL_TIME_ELAPSED queries. Two queries alternate so the result of
+    // the previous frame is read while the current one runs, which keeps the CPU from waiting on the GPU.
+    class GpuTimer {
+    public:
+        void create() {
+            glGenQueries(2, queries);
+        }
+
+        void release() {
+            if (queries[0])
+                glDeleteQueries(2, queries);
+            queries[0] = queries[1] = 0;
+        }
+
+        // only one GL_TIME_ELAPSED query can be active at a time, timers can not be nested
+        void begin() {
+            glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+        }
+
+        void end() {
+            glEndQuery(GL_TIME_ELAPSED);
+            pending[current] = true;
+            current ^= 1;
+            if (!pending[current])
+                return;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[current], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+                read(current);
+        }
+
+        // waits for the query that just ended, for benchmarks where stalling does not matter
+        double finish() {
+            read(current ^ 1);
+            return milliseconds;
+        }
+
+        // last finished measurement, usually one frame old
+        double elapsedMs() const {
+            return milliseconds;
+        }
+
+    private:
+        unsigned int queries[2] = {0, 0};
+        bool pending[2] = {false, false};
+        int current = 0;
+        double milliseconds = 0.0;
+
+        void read(int index) {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &nanoseconds);
+            milliseconds = nanoseconds / 1.0e6;
+            pending[index] = false;
+        }
+    };
+
+    // Samples that passed the depth test between begin and end, from GL_SAMPLES_PASSED queries, which is the number
+    // of fragments the lighting shaders ran for when early depth testing is on. Alternates two queries like GpuTimer.
+    class SampleCounter {
+    public:
+        void create() {
+            glGenQueries(2, queries);
+        }
+
+        void release() {
+            if (queries[0])
+                glDeleteQueries(2, queries);
+            queries[0] = queries[1] = 0;
+        }
+
+        // can run while a GpuTimer is active, the query targets differ
+        void begin() {
+            glBeginQuery(GL_SAMPLES_PASSED, queries[current]);
+        }
+
+        void end() {
+            glEndQuery(GL_SAMPLES_PASSED);
+            pending[current] = true;
+            current ^= 1;
+            if (!pending[current])
+                return;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[current], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+                read(current);
+        }
+
+        // waits for the query that just ended
+        unsigned long long finish() {
+            read(current ^ 1);
+            return samples;
+        }
+
+        // last finished count, usually one frame old
+        unsigned long long count() const {
+            return samples;
+        }
+
+    private:
+        unsigned int queries[2] = {0, 0};
+        bool pending[2] = {false, false};
+        int current = 0;
+        unsigned long long samples = 0;
+
+        void read(int index) {
+            GLuint64 result = 0;
+            glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &result);
+            samples = result;
+            pending[index] = false;
+        }
+    };
+
+};
+#endif //PROJECT_BASE_GPUTIMER_H
@@ -0,0 +1,22 @@
+//
+// Created by bambino on 28.2.21..
+//
+
+#ifndef PROJECT_BASE_HASH_H
+#define PROJECT_BASE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rg {
+
+    // 64 bit FNV-1a over raw bytes
+    inline std::uint64_t hashBytes(const void *data, std::size_t size, std::uint64_t hash = 14695981039346656037ull) {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (std::size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+
+};
+#endif //PROJECT_BASE_HASH_H
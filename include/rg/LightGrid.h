@@ -0,0 +1,234 @@
+//
+// Created by bambino on 23.2.21..
+//
+
+#ifndef PROJECT_BASE_LIGHTGRID_H
+#define PROJECT_BASE_LIGHTGRID_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/ClusteredLights.h>
+#include <rg/Maze.h>
+#include <rg/UniformBuffer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+    // which light lists the maze shaders read, see --light-culling
+    enum LightCulling {
+        LIGHT_CULLING_CELLS,    // per maze cell, walls block the lights (LightGrid)
+        LIGHT_CULLING_CLUSTERS  // per view frustum cluster (LightClusters)
+    };
+
+    inline std::string lightCullingDefines(LightCulling culling) {
+        return culling == LIGHT_CULLING_CLUSTERS ? "#define LIGHTS_CLUSTERED\n" : "";
+    }
+
+    // Per cell light lists that respect the maze walls. Every lantern flood-fills the open cells it can reach within
+    // its radius, a light on the other side of a wall never reaches the cell even when it is close. The lists cover a
+    // window of cells around the camera and are only rebuilt when the camera moves into another block, the lanterns
+    // never move. Fragments look up the cell in front of their surface, see cellLights in resources/shaders/lights.glsl.
+    class LightGrid {
+    public:
+        void create() {
+            GLint maxTexels = 0;
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+            maxIndices = (unsigned int)maxTexels;
+            cellGrid.create(GL_RG32UI);
+            cellIndices.create(GL_R32UI);
+        }
+
+        void release() {
+            cellGrid.release();
+            cellIndices.release();
+        }
+
+        // forces a rebuild on the next update, e.g. after the lights changed
+        void invalidate() {
+            window = MazeRect{0, 0, 0, 0};
+        }
+
+        // rebuilds the lists when the window of cells within reach of the camera changed, returns true if it did
+        bool update(const Maze &maze, const LightClusters &lights, const glm::vec3 &cameraPos, float reach) {
+            MazeRect rect = windowAround(maze, cameraPos, reach);
+            if (rect.x0 == window.x0 && rect.z0 == window.z0 && rect.x1 == window.x1 && rect.z1 == window.z1)
+                return false;
+            build(maze, lights, rect);
+            return true;
+        }
+
+        // builds the lists of every cell in rect
+        void build(const Maze &maze, const LightClusters &lights, const MazeRect &rect) {
+            window = rect;
+            int cells = rect.width() * rect.height();
+            pairs.clear();
+            // a light can reach a window cell through corridors outside of it, so the fill runs over the window grown
+            // by the whole disk of a light up to reach outside of it (see floodFill), only the window cells keep the light
+            float reach = lights.lightRadius() + 0.71f;
+            int grow = (int)std::ceil(2.0f * reach);
+            fillRect = MazeRect{std::max(rect.x0 - grow, 0), std::max(rect.z0 - grow, 0),
+                                std::min(rect.x1 + grow, maze.width), std::min(rect.z1 + grow, maze.height)};
+            fillRect.x1 = std::max(fillRect.x1, fillRect.x0);
+            fillRect.z1 = std::max(fillRect.z1, fillRect.z0);
+            stamps.assign(fillRect.width() * fillRect.height(), 0);
+
+            // the lights that can reach into the window, their centre may be outside of it
+            glm::vec3 center((rect.x0 + rect.x1 - 1) * 0.5f, 0.0f, (rect.z0 + rect.z1 - 1) * 0.5f);
+            float halfDiagonal = 0.5f * std::sqrt((float)(rect.width() * rect.width() + rect.height() * rect.height()));
+            lights.gatherNearby(center, halfDiagonal + reach, nearby);
+            unsigned int stamp = 0;
+            for (unsigned int light : nearby)
+                floodFill(maze, light, lights.lightPosition(light), lights.lightRadius(), ++stamp);
+
+            // counting sort of the (cell, light) pairs into one index list
+            counts.assign(cells * 2, 0);
+            for (const auto &pair : pairs)
+                counts[pair.first * 2 + 1]++;
+            unsigned int offset = 0;
+            for (int cell = 0; cell < cells; cell++) {
+                counts[cell * 2] = offset;
+                offset += counts[cell * 2 + 1];
+            }
+            indices.resize(pairs.size());
+            fill.assign(cells, 0);
+            for (const auto &pair : pairs)
+                indices[counts[pair.first * 2] + fill[pair.first]++] = pair.second;
+
+            // same cap as the cluster lists, the cells at the end of the window lose lights
+            overflow = 0;
+            if (indices.size() > maxIndices) {
+                overflow = indices.size() - maxIndices;
+                indices.resize(maxIndices);
+                for (int cell = 0; cell < cells; cell++) {
+                    unsigned int start = std::min(counts[cell * 2], maxIndices);
+                    counts[cell * 2] = start;
+                    counts[cell * 2 + 1] = std::min(counts[cell * 2 + 1], maxIndices - start);
+                }
+            }
+
+            cellGrid.upload(counts.data(), counts.size() * sizeof(unsigned int), GL_DYNAMIC_DRAW);
+            cellIndices.upload(indices.data(), indices.size() * sizeof(unsigned int), GL_DYNAMIC_DRAW);
+        }
+
+        void fillFrameData(FrameData &frameData) const {
+            frameData.lightGridWindow = glm::vec4(window.x0, window.z0, window.width(), window.height());
+        }
+
+        void bind() const {
+            cellGrid.bind(CELL_GRID_UNIT);
+            cellIndices.bind(CELL_INDEX_UNIT);
+        }
+
+        const MazeRect &cellWindow() const {
+            return window;
+        }
+
+        // first entry and light count of a cell inside the window, the CPU side of cellLights
+        glm::uvec2 cellLights(int x, int z) const {
+            if (!window.contains(x, z))
+                return glm::uvec2(0);
+            int cell = (z - window.z0) * window.width() + (x - window.x0);
+            return glm::uvec2(counts[cell * 2], counts[cell * 2 + 1]);
+        }
+
+        const std::vector<unsigned int> &lightIndices() const {
+            return indices;
+        }
+
+        // lights that reached the window at the last rebuild
+        unsigned int nearbyCount() const {
+            return nearby.size();
+        }
+
+        // entries in the cell index list, i.e. the sum of lights over all cells of the window
+        unsigned int indexCount() const {
+            return indices.size();
+        }
+
+        unsigned int overflowCount() const {
+            return overflow;
+        }
+
+    private:
+        // the window snaps to blocks of cells so small camera moves do not rebuild the lists
+        static const int BLOCK_SIZE = 16;
+
+        TextureBuffer cellGrid;      // offset into cellIndices and light count per cell of the window
+        TextureBuffer cellIndices;
+        unsigned int maxIndices = 65536;
+        MazeRect window{0, 0, 0, 0};
+        MazeRect fillRect{0, 0, 0, 0};  // window grown by twice the light reach, the area the flood fills cover
+
+        // kept to avoid reallocating
+        std::vector<unsigned int> nearby;
+        std::vector<unsigned int> stamps;    // light that last visited a cell of fillRect, saves clearing a visited array per light
+        std::vector<int> queue;              // cells of fillRect
+        std::vector<std::pair<unsigned int, unsigned int>> pairs;
+        std::vector<unsigned int> counts;
+        std::vector<unsigned int> fill;
+        std::vector<unsigned int> indices;
+        unsigned int overflow = 0;
+
+        MazeRect windowAround(const Maze &maze, const glm::vec3 &position, float reach) const {
+            auto snapDown = [](float v) { return (int)std::floor(v / BLOCK_SIZE) * BLOCK_SIZE; };
+            auto snapUp = [](float v) { return (int)std::ceil(v / BLOCK_SIZE) * BLOCK_SIZE; };
+            MazeRect rect{std::max(snapDown(position.x - reach), 0), std::max(snapDown(position.z - reach), 0),
+                          std::min(snapUp(position.x + reach + 1.0f), maze.width), std::min(snapUp(position.z + reach + 1.0f), maze.height)};
+            rect.x1 = std::max(rect.x1, rect.x0);
+            rect.z1 = std::max(rect.z1, rect.z0);
+            return rect;
+        }
+
+        // Breadth first over the open cells around the light, 4-neighbours only so light does not leak through the
+        // corners of two diagonal walls. A cell counts when any part of it is within radius, so its centre may be
+        // up to half a diagonal further away. Walls bordering a lit cell get the light too, which lights their top face.
+        void floodFill(const Maze &maze, unsigned int light, const glm::vec3 &position, float radius, unsigned int stamp) {
+            int width = fillRect.width();
+            float reach = radius + 0.71f;
+            auto inRange = [&](int x, int z) {
+                float dx = x - position.x, dz = z - position.z;
+                return dx * dx + dz * dz <= reach * reach;
+            };
+            // marks the cell, open cells are queued for expansion and wall cells only keep the light
+            auto visit = [&](int x, int z) {
+                if (!fillRect.contains(x, z) || !inRange(x, z))
+                    return;
+                int cell = (z - fillRect.z0) * width + (x - fillRect.x0);
+                if (stamps[cell] == stamp)
+                    return;
+                stamps[cell] = stamp;
+                if (window.contains(x, z))
+                    pairs.push_back(std::make_pair((unsigned int)((z - window.z0) * window.width() + (x - window.x0)), light));
+                if (!maze.isWall(x, z))
+                    queue.push_back(cell);
+            };
+
+            queue.clear();
+            int x = (int)std::round(position.x), z = (int)std::round(position.z);
+            if (maze.isWall(x, z)) {
+                // a lantern inside a wall still lights the corridors next to it
+                visit(x, z);
+                visit(x + 1, z);
+                visit(x - 1, z);
+                visit(x, z + 1);
+                visit(x, z - 1);
+            } else {
+                visit(x, z);
+            }
+            for (size_t head = 0; head < queue.size(); head++) {
+                int cx = fillRect.x0 + queue[head] % width, cz = fillRect.z0 + queue[head] / width;
+                visit(cx + 1, cz);
+                visit(cx - 1, cz);
+                visit(cx, cz + 1);
+                visit(cx, cz - 1);
+            }
+        }
+    };
+
+};
+#endif //PROJECT_BASE_LIGHTGRID_H
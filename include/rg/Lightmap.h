@@ -0,0 +1,380 @@
+//
+// Created by bambino on 25.2.21..
+//
+
+#ifndef PROJECT_BASE_LIGHTMAP_H
+#define PROJECT_BASE_LIGHTMAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/ClusteredLights.h>
+#include <rg/Hash.h>
+#include <rg/Maze.h>
+#include <rg/MazeMesh.h>
+#include <rg/SurfaceLighting.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rg {
+
+    // lightmap layout, keep in sync with resources/shaders/lightmap.glsl
+    const int LIGHTMAP_TEXELS_PER_UNIT = 2;
+    const float LIGHTMAP_RANGE = 8.0f;                  // brightest RGBM value
+    const unsigned int LIGHTMAP_NO_PAGE = 0xFFFFFFFFu;
+    const unsigned int LIGHTMAP_BASE_MASK = 0x07FFFFFFu;
+    const int LIGHTMAP_FACE_SHIFT = 27;
+
+    // texture units of the baked light, the last two of the 16 every GL 3.3 fragment stage has
+    const int LIGHTMAP_PAGE_UNIT = 14;
+    const int LIGHTMAP_TEXEL_UNIT = 15;
+
+    // bumped when the bake or the file layout changes, so old cache files are rebaked
+    const std::uint32_t LIGHTMAP_VERSION = 1;
+
+    // Lantern light baked over the maze surfaces. There is no lightmap UV unwrap: the maze is a grid, so a surface
+    // point is found from its cell and normal. Every lit cell has a page of texels, the face looking up (floor of an
+    // open cell, top of a wall cell) and the wall faces around an open cell, indexed by the direction of their normal.
+    struct LightmapData {
+        MazeRect rect{0, 0, 0, 0};          // cells covered by pages
+        std::vector<std::uint32_t> pages;   // per cell of rect: first texel, wall faces present; LIGHTMAP_NO_PAGE when unlit
+        std::vector<std::uint32_t> texels;  // RGBM, RGBA8 in memory order
+
+        bool empty() const {
+            return texels.empty();
+        }
+    };
+
+    // wall faces of an open cell, bit i of a page's face mask; the floor or top face is always there
+    enum LightmapFace {
+        LIGHTMAP_FACE_POS_X,    // normal +x, the wall at x - 1
+        LIGHTMAP_FACE_NEG_X,
+        LIGHTMAP_FACE_POS_Z,
+        LIGHTMAP_FACE_NEG_Z
+    };
+
+    // rgb * alpha * LIGHTMAP_RANGE, which keeps 8 bits of precision for the dim ambient light and the bright spots
+    inline std::uint32_t encodeRgbm(const glm::vec3 &color) {
+        float peak = std::max(std::max(color.x, color.y), std::max(color.z, 1e-6f));
+        float m = std::min(std::ceil(peak / LIGHTMAP_RANGE * 255.0f), 255.0f) / 255.0f;
+        auto channel = [&](float value) {
+            return (std::uint32_t)std::min(std::max(std::round(value / (m * LIGHTMAP_RANGE) * 255.0f), 0.0f), 255.0f);
+        };
+        return channel(color.x) | channel(color.y) << 8 | channel(color.z) << 16 | (std::uint32_t)(m * 255.0f + 0.5f) << 24;
+    }
+
+    inline glm::vec3 decodeRgbm(std::uint32_t rgbm) {
+        float m = (rgbm >> 24) / 255.0f * LIGHTMAP_RANGE;
+        return glm::vec3((rgbm & 255u) / 255.0f, (rgbm >> 8 & 255u) / 255.0f, (rgbm >> 16 & 255u) / 255.0f) * m;
+    }
+
+    // everything the texels depend on: the maze, the lanterns and the material colours
+    inline std::uint64_t lightmapKey(const Maze &maze, const LightClusters &lights, const glm::vec3 &attenuation,
+                                     const SurfaceLighting &wall, const SurfaceLighting &floor) {
+        std::int32_t header[4] = {(std::int32_t)LIGHTMAP_VERSION, LIGHTMAP_TEXELS_PER_UNIT, maze.width, maze.height};
+        std::uint64_t hash = hashBytes(header, sizeof(header));
+        hash = hashBytes(maze.cells.data(), maze.cells.size(), hash);
+        for (unsigned int i = 0; i < lights.lightCount(); i++)
+            hash = hashBytes(&lights.lightPosition(i), sizeof(glm::vec3), hash);
+        float radius = lights.lightRadius();
+        hash = hashBytes(&radius, sizeof(radius), hash);
+        hash = hashBytes(&attenuation, sizeof(attenuation), hash);
+        for (const SurfaceLighting *lighting : {&wall, &floor}) {
+            hash = hashBytes(&lighting->pointAmbient, sizeof(glm::vec3), hash);
+            hash = hashBytes(&lighting->pointDiffuse, sizeof(glm::vec3), hash);
+        }
+        return hash;
+    }
+
+    // true when no wall cell lies between a and b in the xz plane; the cells of a and b themselves are not tested,
+    // a wall top or a lantern standing in a wall still reaches its neighbours. Walls are higher than the lanterns,
+    // so looking from above is enough.
+    inline bool clearPath(const Maze &maze, const glm::vec3 &a, const glm::vec3 &b) {
+        // cell (x, z) spans [x - 0.5, x + 0.5), shifted so it spans [x, x + 1)
+        float ax = a.x + 0.5f, az = a.z + 0.5f, bx = b.x + 0.5f, bz = b.z + 0.5f;
+        int x = (int)std::floor(ax), z = (int)std::floor(az);
+        int endX = (int)std::floor(bx), endZ = (int)std::floor(bz);
+        float dx = bx - ax, dz = bz - az;
+        int stepX = dx > 0.0f ? 1 : -1, stepZ = dz > 0.0f ? 1 : -1;
+        float deltaX = dx != 0.0f ? std::abs(1.0f / dx) : 1e30f;
+        float deltaZ = dz != 0.0f ? std::abs(1.0f / dz) : 1e30f;
+        float nextX = dx != 0.0f ? (stepX > 0 ? x + 1 - ax : ax - x) * deltaX : 1e30f;
+        float nextZ = dz != 0.0f ? (stepZ > 0 ? z + 1 - az : az - z) * deltaZ : 1e30f;
+        // one step per cell boundary crossed
+        for (int steps = std::abs(endX - x) + std::abs(endZ - z); steps > 0; steps--) {
+            if (nextX < nextZ) {
+                x += stepX;
+                nextX += deltaX;
+            } else {
+                z += stepZ;
+                nextZ += deltaZ;
+            }
+            if ((x != endX || z != endZ) && maze.isWall(x, z))
+                return false;
+        }
+        return true;
+    }
+
+    // Bakes the ambient and diffuse light of the lanterns over every maze surface within their radius, with wall
+    // shadows. Pages are laid out first, then the rows of cells are shared out to threads (all cores when 0).
+    inline LightmapData bakeLightmap(const Maze &maze, const LightClusters &lights, const glm::vec3 &attenuation,
+                                     const SurfaceLighting &wall, const SurfaceLighting &floor, unsigned int threads = 0) {
+        const int texels = LIGHTMAP_TEXELS_PER_UNIT;
+        const int upTexels = texels * texels;
+        const int sideTexels = texels * texels * 2;     // walls are MAZE_WALL_HEIGHT units high
+        float radius = lights.lightRadius();
+        LightmapData data;
+        if (lights.lightCount() == 0)
+            return data;
+
+        // cells that any part of a lantern's sphere touches
+        int reach = (int)std::ceil(radius) + 1;
+        MazeRect rect{maze.width, maze.height, 0, 0};
+        std::vector<unsigned char> lit(maze.width * maze.height, 0);
+        for (unsigned int i = 0; i < lights.lightCount(); i++) {
+            const glm::vec3 &light = lights.lightPosition(i);
+            int lx = (int)std::round(light.x), lz = (int)std::round(light.z);
+            for (int z = std::max(lz - reach, 0); z <= std::min(lz + reach, maze.height - 1); z++) {
+                for (int x = std::max(lx - reach, 0); x <= std::min(lx + reach, maze.width - 1); x++) {
+                    float dx = x - light.x, dz = z - light.z;
+                    if (dx * dx + dz * dz > (radius + 0.71f) * (radius + 0.71f))
+                        continue;
+                    lit[z * maze.width + x] = 1;
+                    rect = MazeRect{std::min(rect.x0, x), std::min(rect.z0, z), std::max(rect.x1, x + 1), std::max(rect.z1, z + 1)};
+                }
+            }
+        }
+        if (rect.x1 <= rect.x0)
+            return data;
+
+        // pages: the up face, then the wall faces that exist around open cells
+        data.rect = rect;
+        data.pages.assign(rect.width() * rect.height(), LIGHTMAP_NO_PAGE);
+        std::uint32_t offset = 0;
+        for (int z = rect.z0; z < rect.z1; z++) {
+            for (int x = rect.x0; x < rect.x1; x++) {
+                if (!lit[z * maze.width + x])
+                    continue;
+                std::uint32_t faces = 0;
+                if (!maze.isWall(x, z)) {
+                    faces |= maze.isWall(x - 1, z) ? 1u << LIGHTMAP_FACE_POS_X : 0u;
+                    faces |= maze.isWall(x + 1, z) ? 1u << LIGHTMAP_FACE_NEG_X : 0u;
+                    faces |= maze.isWall(x, z - 1) ? 1u << LIGHTMAP_FACE_POS_Z : 0u;
+                    faces |= maze.isWall(x, z + 1) ? 1u << LIGHTMAP_FACE_NEG_Z : 0u;
+                }
+                if (offset > LIGHTMAP_BASE_MASK) {
+                    std::cout << "ERROR::LIGHTMAP::TOO_MANY_TEXELS" << std::endl;
+                    return LightmapData();
+                }
+                data.pages[(z - rect.z0) * rect.width() + (x - rect.x0)] = offset | faces << LIGHTMAP_FACE_SHIFT;
+                int sides = 0;
+                for (std::uint32_t bits = faces; bits; bits &= bits - 1)
+                    sides++;
+                offset += upTexels + sides * sideTexels;
+            }
+        }
+        data.texels.resize(offset);
+
+        // light of one surface point, the same terms as CalcPointLight in lighting.glsl without the specular
+        auto shade = [&](const glm::vec3 &position, const glm::vec3 &normal, const SurfaceLighting &material, std::vector<unsigned int> &nearby) {
+            glm::vec3 color(0.0f);
+            lights.gatherNearby(position, radius, nearby);
+            for (unsigned int light : nearby) {
+                glm::vec3 toLight = lights.lightPosition(light) - position;
+                float distance = glm::length(toLight);
+                if (distance >= radius || !clearPath(maze, position + normal * 0.01f, lights.lightPosition(light)))
+                    continue;
+                float ratio = distance / radius;
+                float window = std::min(std::max(1.0f - ratio * ratio * ratio * ratio, 0.0f), 1.0f);
+                float falloff = window * window / (attenuation.x + attenuation.y * distance + attenuation.z * distance * distance);
+                float diffuse = distance > 0.0f ? std::max(glm::dot(normal, toLight / distance), 0.0f) : 1.0f;
+                color += (material.pointAmbient + material.pointDiffuse * diffuse) * falloff;
+            }
+            return color;
+        };
+
+        // face texel (u, v) sits at corner + (u + 0.5) / texels * along + (v + 0.5) / texels * up
+        auto bakeFace = [&](std::uint32_t first, const glm::vec3 &corner, const glm::vec3 &along, const glm::vec3 &up, int rows,
+                            const glm::vec3 &normal, const SurfaceLighting &material, std::vector<unsigned int> &nearby) {
+            for (int v = 0; v < rows; v++) {
+                for (int u = 0; u < texels; u++) {
+                    glm::vec3 position = corner + along * ((u + 0.5f) / texels) + up * ((v + 0.5f) / texels);
+                    data.texels[first + v * texels + u] = encodeRgbm(shade(position, normal, material, nearby));
+                }
+            }
+        };
+
+        std::atomic<int> nextRow(rect.z0);
+        auto worker = [&]() {
+            std::vector<unsigned int> nearby;
+            for (int z = nextRow++; z < rect.z1; z = nextRow++) {
+                for (int x = rect.x0; x < rect.x1; x++) {
+                    std::uint32_t page = data.pages[(z - rect.z0) * rect.width() + (x - rect.x0)];
+                    if (page == LIGHTMAP_NO_PAGE)
+                        continue;
+                    std::uint32_t first = page & LIGHTMAP_BASE_MASK;
+                    std::uint32_t faces = page >> LIGHTMAP_FACE_SHIFT;
+                    float x0 = x - 0.5f, z0 = z - 0.5f;
+                    bool wallCell = maze.isWall(x, z);
+                    float y = wallCell ? MAZE_FLOOR_Y + MAZE_WALL_HEIGHT : MAZE_FLOOR_Y;
+                    bakeFace(first, glm::vec3(x0, y, z0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1), texels,
+                             glm::vec3(0, 1, 0), wallCell ? wall : floor, nearby);
+                    first += upTexels;
+
+                    // wall faces: u runs along +z or +x, v up from the floor
+                    const glm::vec3 height(0, 1, 0);
+                    struct Side { LightmapFace face; glm::vec3 corner, along, normal; } sides[4] = {
+                            {LIGHTMAP_FACE_POS_X, glm::vec3(x0, MAZE_FLOOR_Y, z0), glm::vec3(0, 0, 1), glm::vec3(1, 0, 0)},
+                            {LIGHTMAP_FACE_NEG_X, glm::vec3(x0 + 1.0f, MAZE_FLOOR_Y, z0), glm::vec3(0, 0, 1), glm::vec3(-1, 0, 0)},
+                            {LIGHTMAP_FACE_POS_Z, glm::vec3(x0, MAZE_FLOOR_Y, z0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1)},
+                            {LIGHTMAP_FACE_NEG_Z, glm::vec3(x0, MAZE_FLOOR_Y, z0 + 1.0f), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1)}};
+                    for (const Side &side : sides) {
+                        if (!(faces & 1u << side.face))
+                            continue;
+                        bakeFace(first, side.corner, side.along, height, texels * 2, side.normal, wall, nearby);
+                        first += sideTexels;
+                    }
+                }
+            }
+        };
+
+        if (threads == 0)
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<std::thread> pool;
+        for (unsigned int i = 1; i < threads; i++)
+            pool.emplace_back(worker);
+        worker();
+        for (std::thread &thread : pool)
+            thread.join();
+        return data;
+    }
+
+    // cache file: header, pages, texels; anything that does not match key is ignored
+    struct LightmapFileHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::int32_t rect[4];
+        std::uint64_t pageCount;
+        std::uint64_t texelCount;
+    };
+
+    inline bool loadLightmap(const std::string &path, std::uint64_t key, LightmapData &data) {
+        std::ifstream file(path, std::ios::binary);
+        LightmapFileHeader header;
+        if (!file.read((char *)&header, sizeof(header)))
+            return false;
+        if (std::memcmp(header.magic, "RGLM", 4) != 0 || header.version != LIGHTMAP_VERSION || header.key != key)
+            return false;
+        data.rect = MazeRect{header.rect[0], header.rect[1], header.rect[2], header.rect[3]};
+        if (header.pageCount != (std::uint64_t)data.rect.width() * data.rect.height())
+            return false;
+        data.pages.resize(header.pageCount);
+        data.texels.resize(header.texelCount);
+        if (!file.read((char *)data.pages.data(), data.pages.size() * sizeof(std::uint32_t)) ||
+            !file.read((char *)data.texels.data(), data.texels.size() * sizeof(std::uint32_t))) {
+            data = LightmapData();
+            return false;
+        }
+        return true;
+    }
+
+    inline bool saveLightmap(const std::string &path, std::uint64_t key, const LightmapData &data) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        LightmapFileHeader header = {{'R', 'G', 'L', 'M'}, LIGHTMAP_VERSION, key,
+                                     {data.rect.x0, data.rect.z0, data.rect.x1, data.rect.z1},
+                                     data.pages.size(), data.texels.size()};
+        file.write((const char *)&header, sizeof(header));
+        file.write((const char *)data.pages.data(), data.pages.size() * sizeof(std::uint32_t));
+        file.write((const char *)data.texels.data(), data.texels.size() * sizeof(std::uint32_t));
+        if (!file) {
+            std::cout << "ERROR::LIGHTMAP::CACHE_WRITE_FAILED " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // the lightmap of these lanterns from cacheDir when it was baked before, otherwise baked and stored there
+    inline LightmapData loadOrBakeLightmap(const Maze &maze, const LightClusters &lights, const glm::vec3 &attenuation,
+                                           const std::string &cacheDir) {
+        std::uint64_t key = lightmapKey(maze, lights, attenuation, WALL_LIGHTING, FLOOR_LIGHTING);
+        char name[32];
+        std::snprintf(name, sizeof(name), "lightmap_%016llx.bin", (unsigned long long)key);
+        std::string path = cacheDir + "/" + name;
+
+        LightmapData data;
+        if (loadLightmap(path, key, data)) {
+            std::cout << "Lightmap " << data.texels.size() << " texels from " << path << std::endl;
+            return data;
+        }
+        auto start = std::chrono::steady_clock::now();
+        data = bakeLightmap(maze, lights, attenuation, WALL_LIGHTING, FLOOR_LIGHTING);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Lightmap " << data.texels.size() << " texels baked in " << elapsed.count() << " ms on "
+                  << std::max(std::thread::hardware_concurrency(), 1u) << " threads" << std::endl;
+        if (!data.empty())
+            saveLightmap(path, key, data);
+        return data;
+    }
+
+    // the baked light on the GPU, read by sampleLightmap in resources/shaders/lightmap.glsl
+    class Lightmap {
+    public:
+        // false when there is nothing to show or the texels exceed the buffer texture limit
+        bool upload(const LightmapData &data) {
+            GLint maxTexels = 0;
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+            if (data.empty())
+                return false;
+            if (data.texels.size() > (std::size_t)maxTexels || data.pages.size() > (std::size_t)maxTexels) {
+                std::cout << "ERROR::LIGHTMAP::TOO_LARGE " << data.texels.size() << " texels" << std::endl;
+                return false;
+            }
+            rect = data.rect;
+            if (!pages.buffer) {
+                pages.create(GL_R32UI);
+                texels.create(GL_RGBA8);
+            }
+            pages.upload(data.pages.data(), data.pages.size() * sizeof(std::uint32_t), GL_STATIC_DRAW);
+            texels.upload(data.texels.data(), data.texels.size() * sizeof(std::uint32_t), GL_STATIC_DRAW);
+            return true;
+        }
+
+        // samplers and the covered cells of a program built with LIGHTMAP
+        void setUniforms(const Shader &shader) const {
+            shader.use();
+            shader.setInt("lightmapPages", LIGHTMAP_PAGE_UNIT);
+            shader.setInt("lightmapTexels", LIGHTMAP_TEXEL_UNIT);
+            shader.setVec4("lightmapRect", glm::vec4(rect.x0, rect.z0, rect.width(), rect.height()));
+        }
+
+        void bind() const {
+            pages.bind(LIGHTMAP_PAGE_UNIT);
+            texels.bind(LIGHTMAP_TEXEL_UNIT);
+        }
+
+        void release() {
+            pages.release();
+            texels.release();
+        }
+
+    private:
+        TextureBuffer pages;
+        TextureBuffer texels;
+        MazeRect rect{0, 0, 0, 0};
+    };
+
+};
+#endif //PROJECT_BASE_LIGHTMAP_H
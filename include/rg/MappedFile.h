@@ -0,0 +1,68 @@
+//
+// Created by bambino on 2.3.21..
+//
+
+#ifndef PROJECT_BASE_MAPPEDFILE_H
+#define PROJECT_BASE_MAPPEDFILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <string>
+
+namespace rg {
+
+    // a whole file mapped read only, the pages are read in by the kernel as they are touched
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+            close();
+        }
+
+        // false when the file is missing, empty or cannot be mapped
+        bool open(const std::string &path) {
+            close();
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    bytes = (const unsigned char *)mapped;
+                    length = info.st_size;
+                }
+            }
+            ::close(fd);
+            return bytes != nullptr;
+        }
+
+        void close() {
+            if (bytes)
+                munmap((void *)bytes, length);
+            bytes = nullptr;
+            length = 0;
+        }
+
+        const unsigned char *data() const {
+            return bytes;
+        }
+
+        std::size_t size() const {
+            return length;
+        }
+
+    private:
+        const unsigned char *bytes = nullptr;
+        std::size_t length = 0;
+    };
+
+};
+#endif //PROJECT_BASE_MAPPEDFILE_H
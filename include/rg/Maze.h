@@ -0,0 +1,143 @@
+//
+// Created by bambino on 10.2.21..
+//
+
+#ifndef PROJECT_BASE_MAZE_H
+#define PROJECT_BASE_MAZE_H
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+    // half-open range of cells [x0, x1) x [z0, z1)
+    struct MazeRect {
+        int x0, z0, x1, z1;
+
+        bool contains(int x, int z) const {
+            return x >= x0 && z >= z0 && x < x1 && z < z1;
+        }
+
+        int width() const { return x1 - x0; }
+        int height() const { return z1 - z0; }
+    };
+
+    // maze grid, cell (x, z) lives at world position (x, 0, z); 1 in the map file is a wall, 0 is open, and either
+    // can be followed by the variant of its material, "1:1" or "0:1" (see MazeMaterials.h)
+    class Maze {
+    public:
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> cells;
+        std::vector<unsigned char> variants;
+
+        Maze() = default;
+        Maze(int width, int height) : width(width), height(height), cells(width * height, 0), variants(width * height, 0) {}
+
+        // everything outside of the grid counts as open space
+        bool isWall(int x, int z) const {
+            if (x < 0 || z < 0 || x >= width || z >= height)
+                return false;
+            return cells[z * width + x] != 0;
+        }
+
+        void setWall(int x, int z, bool wall) {
+            cells[z * width + x] = wall ? 1 : 0;
+        }
+
+        // material variant of the wall or the floor of a cell, 0 outside of the grid
+        unsigned int variant(int x, int z) const {
+            if (x < 0 || z < 0 || x >= width || z >= height)
+                return 0;
+            return variants[z * width + x];
+        }
+
+        void setVariant(int x, int z, unsigned int variant) {
+            variants[z * width + x] = (unsigned char)variant;
+        }
+
+        MazeRect bounds() const {
+            return MazeRect{0, 0, width, height};
+        }
+
+        // reads one row per line, the width is taken from the first row
+        static Maze loadFromFile(const std::string &path) {
+            Maze maze;
+            std::ifstream file(path);
+            if (!file) {
+                std::cout << "ERROR::MAZE::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+                return maze;
+            }
+
+            std::string line;
+            while (std::getline(file, line)) {
+                std::istringstream row(line);
+                std::vector<unsigned char> values, rowVariants;
+                std::string token;
+                while (row >> token) {
+                    int value, variant = 0;
+                    if (std::sscanf(token.c_str(), "%d:%d", &value, &variant) < 1)
+                        break;
+                    values.push_back(value != 0 ? 1 : 0);
+                    rowVariants.push_back((unsigned char)std::min(std::max(variant, 0), 255));
+                }
+                if (values.empty())
+                    continue;
+                if (maze.width == 0)
+                    maze.width = values.size();
+                values.resize(maze.width, 0);
+                rowVariants.resize(maze.width, 0);
+                maze.cells.insert(maze.cells.end(), values.begin(), values.end());
+                maze.variants.insert(maze.variants.end(), rowVariants.begin(), rowVariants.end());
+                maze.height++;
+            }
+            return maze;
+        }
+
+        // perfect maze carved with an iterative depth-first backtracker, passages run on odd coordinates
+        static Maze generate(int width, int height, unsigned int seed) {
+            Maze maze(width, height);
+            std::fill(maze.cells.begin(), maze.cells.end(), 1);
+            if (width < 3 || height < 3)
+                return maze;
+
+            std::mt19937 rng(seed);
+            const int dx[4] = {2, -2, 0, 0};
+            const int dz[4] = {0, 0, 2, -2};
+            std::vector<int> stack;
+            stack.push_back(1 * width + 1);
+            maze.setWall(1, 1, false);
+            while (!stack.empty()) {
+                int x = stack.back() % width;
+                int z = stack.back() / width;
+
+                int options[4];
+                int count = 0;
+                for (int d = 0; d < 4; d++) {
+                    int nx = x + dx[d];
+                    int nz = z + dz[d];
+                    if (nx > 0 && nz > 0 && nx < width - 1 && nz < height - 1 && maze.isWall(nx, nz))
+                        options[count++] = d;
+                }
+                if (count == 0) {
+                    stack.pop_back();
+                    continue;
+                }
+
+                int d = options[rng() % count];
+                maze.setWall(x + dx[d] / 2, z + dz[d] / 2, false);
+                maze.setWall(x + dx[d], z + dz[d], false);
+                stack.push_back((z + dz[d]) * width + x + dx[d]);
+            }
+            return maze;
+        }
+    };
+
+};
+#endif //PROJECT_BASE_MAZE_H
@@ -0,0 +1,56 @@
+//
+// Created by bambino on 1.3.21..
+//
+
+#ifndef PROJECT_BASE_MAZEMATERIALS_H
+#define PROJECT_BASE_MAZEMATERIALS_H
+
+namespace rg {
+
+    // material ids, written to the G-buffer and indexing the lighting arrays of the maze shaders; keep in sync with
+    // resources/shaders/materials.glsl
+    const int MATERIAL_UNLIT = 0;
+    const int MATERIAL_WALL = 1;
+    const int MATERIAL_FLOOR = 2;
+
+    // the texture array with every maze texture, bound once per frame
+    const int MAZE_TEXTURE_UNIT = 1;
+    // every layer is resized to this when it is loaded
+    const int MAZE_TEXTURE_SIZE = 1024;
+
+    // the layers of the array in order, paths for FileSystem::getPath; new textures go at the end
+    const char *const MAZE_TEXTURE_LAYERS[] = {
+            "resources/textures/brickwall.jpg",
+            "resources/textures/brickwall_normal.jpg",
+            "resources/textures/stone.jpg"};
+    const unsigned int MAZE_TEXTURE_LAYER_COUNT = sizeof(MAZE_TEXTURE_LAYERS) / sizeof(MAZE_TEXTURE_LAYERS[0]);
+
+    // what a face of the maze looks like, stored in every vertex so any mix of materials is one draw call
+    struct MazeMaterial {
+        unsigned char diffuseLayer;
+        unsigned char specularLayer;
+        unsigned char lighting;     // MATERIAL_WALL or MATERIAL_FLOOR, picks the SurfaceLighting
+        unsigned char padding;
+
+        bool operator==(const MazeMaterial &other) const {
+            return diffuseLayer == other.diffuseLayer && specularLayer == other.specularLayer && lighting == other.lighting;
+        }
+    };
+
+    // variants of the walls and of the floor, the number after the colon in the map file ("1:1" is a stone wall)
+    const MazeMaterial WALL_MATERIALS[] = {
+            {0, 1, MATERIAL_WALL, 0},   // brick
+            {2, 2, MATERIAL_WALL, 0}};  // stone
+    const MazeMaterial FLOOR_MATERIALS[] = {
+            {2, 2, MATERIAL_FLOOR, 0},  // stone
+            {0, 1, MATERIAL_FLOOR, 0}}; // brick
+
+    // an unknown variant falls back to the first one
+    inline MazeMaterial mazeMaterial(bool wall, unsigned int variant) {
+        if (wall)
+            return WALL_MATERIALS[variant < sizeof(WALL_MATERIALS) / sizeof(WALL_MATERIALS[0]) ? variant : 0];
+        return FLOOR_MATERIALS[variant < sizeof(FLOOR_MATERIALS) / sizeof(FLOOR_MATERIALS[0]) ? variant : 0];
+    }
+
+};
+#endif //PROJECT_BASE_MAZEMATERIALS_H
@@ -0,0 +1,380 @@
+//
+// Created by bambino on 10.2.21..
+//
+
+#ifndef PROJECT_BASE_MAZEMESH_H
+#define PROJECT_BASE_MAZEMESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/Maze.h>
+#include <rg/MazeMaterials.h>
+#include <rg/FrameStats.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace rg {
+
+    // walls are 2 units tall columns standing on the floor, the floor top is at y = -0.5
+    const float MAZE_FLOOR_Y = -0.5f;
+    const float MAZE_WALL_HEIGHT = 2.0f;
+
+    struct MazeVertex {
+        glm::vec3 Position;
+        glm::vec3 Normal;
+        glm::vec2 TexCoords;
+        MazeMaterial Material;
+    };
+
+    struct MazeMeshData {
+        std::vector<MazeVertex> vertices;
+        std::vector<unsigned int> indices;
+        // greedy builds only: the walls come first, the floor after them
+        unsigned int wallIndexCount = 0;
+        // culled builds only: the indices of cell i of cellRect (row major) are [cellOffsets[i], cellOffsets[i + 1])
+        MazeRect cellRect{0, 0, 0, 0};
+        std::vector<unsigned int> cellOffsets;
+
+        // emits the quad corner, corner + u, corner + u + v, corner + v; cross(u, v) has to point along normal
+        void addQuad(glm::vec3 corner, glm::vec3 u, glm::vec3 v, glm::vec3 normal, glm::vec2 uvScale, MazeMaterial material) {
+            unsigned int base = vertices.size();
+            vertices.push_back({corner, normal, glm::vec2(0.0f, 0.0f), material});
+            vertices.push_back({corner + u, normal, glm::vec2(uvScale.x, 0.0f), material});
+            vertices.push_back({corner + u + v, normal, glm::vec2(uvScale.x, uvScale.y), material});
+            vertices.push_back({corner + v, normal, glm::vec2(0.0f, uvScale.y), material});
+
+            indices.push_back(base);
+            indices.push_back(base + 1);
+            indices.push_back(base + 2);
+            indices.push_back(base + 2);
+            indices.push_back(base + 3);
+            indices.push_back(base);
+        }
+
+        unsigned int triangleCount() const {
+            return indices.size() / 3;
+        }
+    };
+
+    enum MazeMeshMode {
+        MAZE_MESH_CULLED,  // one quad per visible cell face
+        MAZE_MESH_GREEDY,  // coplanar faces of the same material merged into runs along rows and columns
+        MAZE_MESH_CUBES    // every face of the old per cell cubes, hidden ones included; for comparison only
+    };
+
+    inline const char *mazeMeshModeName(MazeMeshMode mode) {
+        switch (mode) {
+            case MAZE_MESH_CULLED: return "culled";
+            case MAZE_MESH_GREEDY: return "greedy";
+            case MAZE_MESH_CUBES: return "cubes";
+        }
+        return "";
+    }
+
+    // the material of the wall of a wall cell, of the floor of an open one
+    inline MazeMaterial cellMaterial(const Maze &maze, int x, int z) {
+        return mazeMaterial(maze.isWall(x, z), maze.variant(x, z));
+    }
+
+    // length of the run of cells inside rect starting at (x, z) and stepping by (stepX, stepZ) for which pred holds
+    template <typename Pred>
+    int faceRun(const MazeRect &rect, int x, int z, int stepX, int stepZ, Pred pred) {
+        int length = 0;
+        while (rect.contains(x, z) && pred(x, z)) {
+            length++;
+            x += stepX;
+            z += stepZ;
+        }
+        return length;
+    }
+
+    // the same, but the run also stops at the first cell with another material than (x, z)
+    template <typename Pred>
+    int materialRun(const Maze &maze, const MazeRect &rect, int x, int z, int stepX, int stepZ, Pred pred) {
+        MazeMaterial material = cellMaterial(maze, x, z);
+        return faceRun(rect, x, z, stepX, stepZ, [&](int cx, int cz) { return pred(cx, cz) && cellMaterial(maze, cx, cz) == material; });
+    }
+
+    // merges the cells of rect accepted by pred into rectangles of one material lying in the plane y, first along x,
+    // then along z
+    template <typename Pred>
+    void addGreedyRectangles(MazeMeshData &data, const Maze &maze, const MazeRect &rect, float y, Pred pred) {
+        std::vector<unsigned char> done(rect.width() * rect.height(), 0);
+        auto isDone = [&](int x, int z) { return done[(z - rect.z0) * rect.width() + x - rect.x0] != 0; };
+        for (int z = rect.z0; z < rect.z1; z++) {
+            for (int x = rect.x0; x < rect.x1; x++) {
+                if (isDone(x, z) || !pred(x, z))
+                    continue;
+                MazeMaterial material = cellMaterial(maze, x, z);
+                auto same = [&](int cx, int cz) { return !isDone(cx, cz) && pred(cx, cz) && cellMaterial(maze, cx, cz) == material; };
+                int w = faceRun(rect, x, z, 1, 0, same);
+                int h = 1;
+                while (z + h < rect.z1 && faceRun(rect, x, z + h, 1, 0, [&](int cx, int cz) {
+                    return cx < x + w && same(cx, cz); }) == w)
+                    h++;
+                for (int rz = z; rz < z + h; rz++)
+                    for (int rx = x; rx < x + w; rx++)
+                        done[(rz - rect.z0) * rect.width() + rx - rect.x0] = 1;
+
+                data.addQuad(glm::vec3((float)x - 0.5f, y, (float)(z + h) - 0.5f), glm::vec3((float)w, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -(float)h),
+                             glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2((float)w, (float)h), material);
+            }
+        }
+    }
+
+    // the six faces of a unit cube around centre, each textured once
+    inline void addCube(MazeMeshData &data, glm::vec3 centre, MazeMaterial material) {
+        const glm::vec3 x(1.0f, 0.0f, 0.0f), y(0.0f, 1.0f, 0.0f), z(0.0f, 0.0f, 1.0f);
+        const glm::vec3 low = centre - glm::vec3(0.5f), high = centre + glm::vec3(0.5f);
+        data.addQuad(glm::vec3(high.x, low.y, high.z), -z, y, x, glm::vec2(1.0f), material);
+        data.addQuad(glm::vec3(low.x, low.y, low.z), z, y, -x, glm::vec2(1.0f), material);
+        data.addQuad(glm::vec3(low.x, low.y, high.z), x, y, z, glm::vec2(1.0f), material);
+        data.addQuad(glm::vec3(high.x, low.y, low.z), -x, y, -z, glm::vec2(1.0f), material);
+        data.addQuad(glm::vec3(low.x, high.y, high.z), x, -z, y, glm::vec2(1.0f), material);
+        data.addQuad(glm::vec3(low.x, low.y, low.z), x, z, -y, glm::vec2(1.0f), material);
+    }
+
+    // Walks the cells of rect once: the wall faces that border open cells, the wall tops and the floor of the open
+    // cells, the floor under the walls is never visible. Every material is in the same mesh, so walls and floor are
+    // one draw call. Culled builds keep the faces of a cell together, greedy builds put the walls first.
+    inline MazeMeshData buildMazeMesh(const Maze &maze, MazeMeshMode mode, const MazeRect &rect) {
+        MazeMeshData data;
+        const glm::vec3 up(0.0f, MAZE_WALL_HEIGHT, 0.0f);
+        const float bottom = MAZE_FLOOR_Y;
+        const float top = MAZE_FLOOR_Y + MAZE_WALL_HEIGHT;
+
+        auto posX = [&](int x, int z) { return maze.isWall(x, z) && !maze.isWall(x + 1, z); };
+        auto negX = [&](int x, int z) { return maze.isWall(x, z) && !maze.isWall(x - 1, z); };
+        auto posZ = [&](int x, int z) { return maze.isWall(x, z) && !maze.isWall(x, z + 1); };
+        auto negZ = [&](int x, int z) { return maze.isWall(x, z) && !maze.isWall(x, z - 1); };
+        auto wall = [&](int x, int z) { return maze.isWall(x, z); };
+        auto open = [&](int x, int z) { return !maze.isWall(x, z); };
+
+        if (mode == MAZE_MESH_GREEDY) {
+            // x facing sides run along z, z facing sides run along x; the texture repeats once per cell of the run
+            for (int x = rect.x0; x < rect.x1; x++) {
+                for (int z = rect.z0; z < rect.z1; ) {
+                    int run = materialRun(maze, rect, x, z, 0, 1, posX);
+                    if (run > 0) {
+                        data.addQuad(glm::vec3((float)x + 0.5f, bottom, (float)(z + run) - 0.5f), glm::vec3(0.0f, 0.0f, -(float)run), up,
+                                     glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2((float)run, MAZE_WALL_HEIGHT), cellMaterial(maze, x, z));
+                        z += run;
+                    } else z++;
+                }
+                for (int z = rect.z0; z < rect.z1; ) {
+                    int run = materialRun(maze, rect, x, z, 0, 1, negX);
+                    if (run > 0) {
+                        data.addQuad(glm::vec3((float)x - 0.5f, bottom, (float)z - 0.5f), glm::vec3(0.0f, 0.0f, (float)run), up,
+                                     glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2((float)run, MAZE_WALL_HEIGHT), cellMaterial(maze, x, z));
+                        z += run;
+                    } else z++;
+                }
+            }
+            for (int z = rect.z0; z < rect.z1; z++) {
+                for (int x = rect.x0; x < rect.x1; ) {
+                    int run = materialRun(maze, rect, x, z, 1, 0, posZ);
+                    if (run > 0) {
+                        data.addQuad(glm::vec3((float)x - 0.5f, bottom, (float)z + 0.5f), glm::vec3((float)run, 0.0f, 0.0f), up,
+                                     glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2((float)run, MAZE_WALL_HEIGHT), cellMaterial(maze, x, z));
+                        x += run;
+                    } else x++;
+                }
+                for (int x = rect.x0; x < rect.x1; ) {
+                    int run = materialRun(maze, rect, x, z, 1, 0, negZ);
+                    if (run > 0) {
+                        data.addQuad(glm::vec3((float)(x + run) - 0.5f, bottom, (float)z - 0.5f), glm::vec3(-(float)run, 0.0f, 0.0f), up,
+                                     glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2((float)run, MAZE_WALL_HEIGHT), cellMaterial(maze, x, z));
+                        x += run;
+                    } else x++;
+                }
+            }
+            addGreedyRectangles(data, maze, rect, top, wall);
+            data.wallIndexCount = data.indices.size();
+            addGreedyRectangles(data, maze, rect, MAZE_FLOOR_Y, open);
+            return data;
+        }
+
+        const glm::vec2 sideUV(1.0f, MAZE_WALL_HEIGHT);
+        data.cellRect = rect;
+        if (mode == MAZE_MESH_CUBES) {
+            // the geometry of the instanced cubes this builder replaced: two stacked cubes per wall cell and a floor
+            // cube under every cell, kept in per cell ranges like the culled build
+            for (int z = rect.z0; z < rect.z1; z++) {
+                for (int x = rect.x0; x < rect.x1; x++) {
+                    data.cellOffsets.push_back(data.indices.size());
+                    glm::vec3 centre((float)x, 0.0f, (float)z);
+                    if (maze.isWall(x, z)) {
+                        addCube(data, centre, cellMaterial(maze, x, z));
+                        addCube(data, centre + glm::vec3(0.0f, 1.0f, 0.0f), cellMaterial(maze, x, z));
+                    }
+                    addCube(data, centre - glm::vec3(0.0f, 1.0f, 0.0f), mazeMaterial(false, maze.variant(x, z)));
+                }
+            }
+            data.cellOffsets.push_back(data.indices.size());
+            return data;
+        }
+        for (int z = rect.z0; z < rect.z1; z++) {
+            for (int x = rect.x0; x < rect.x1; x++) {
+                data.cellOffsets.push_back(data.indices.size());
+                float fx = (float)x;
+                float fz = (float)z;
+                MazeMaterial material = cellMaterial(maze, x, z);
+                if (!maze.isWall(x, z)) {
+                    data.addQuad(glm::vec3(fx - 0.5f, MAZE_FLOOR_Y, fz + 0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f), material);
+                    continue;
+                }
+
+                if (posX(x, z))
+                    data.addQuad(glm::vec3(fx + 0.5f, bottom, fz + 0.5f), glm::vec3(0.0f, 0.0f, -1.0f), up, glm::vec3(1.0f, 0.0f, 0.0f), sideUV, material);
+                if (negX(x, z))
+                    data.addQuad(glm::vec3(fx - 0.5f, bottom, fz - 0.5f), glm::vec3(0.0f, 0.0f, 1.0f), up, glm::vec3(-1.0f, 0.0f, 0.0f), sideUV, material);
+                if (posZ(x, z))
+                    data.addQuad(glm::vec3(fx - 0.5f, bottom, fz + 0.5f), glm::vec3(1.0f, 0.0f, 0.0f), up, glm::vec3(0.0f, 0.0f, 1.0f), sideUV, material);
+                if (negZ(x, z))
+                    data.addQuad(glm::vec3(fx + 0.5f, bottom, fz - 0.5f), glm::vec3(-1.0f, 0.0f, 0.0f), up, glm::vec3(0.0f, 0.0f, -1.0f), sideUV, material);
+
+                data.addQuad(glm::vec3(fx - 0.5f, top, fz + 0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f), material);
+            }
+        }
+        data.cellOffsets.push_back(data.indices.size());
+        return data;
+    }
+
+    inline MazeMeshData buildMazeMesh(const Maze &maze, MazeMeshMode mode = MAZE_MESH_CULLED) {
+        return buildMazeMesh(maze, mode, maze.bounds());
+    }
+
+    // static indexed mesh on the GPU: position, normal and texture coords like the old cube, then the material as four
+    // unsigned integers; a second vertex array reads only the positions, from their own tightly packed buffer, for
+    // depth only passes
+    class MazeMesh {
+    public:
+        unsigned int VAO = 0;
+        unsigned int positionVAO = 0;
+        unsigned int indexCount = 0;
+        unsigned int wallIndexCount = 0;
+
+        MazeMesh() = default;
+
+        explicit MazeMesh(const MazeMeshData &data) {
+            upload(data);
+        }
+
+        void upload(const MazeMeshData &data) {
+            if (VAO == 0) {
+                glGenVertexArrays(1, &VAO);
+                glGenVertexArrays(1, &positionVAO);
+                glGenBuffers(1, &VBO);
+                glGenBuffers(1, &positionVBO);
+                glGenBuffers(1, &EBO);
+            }
+            indexCount = data.indices.size();
+            wallIndexCount = data.wallIndexCount;
+            cellRect = data.cellRect;
+            cellOffsets = data.cellOffsets;
+
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBufferData(GL_ARRAY_BUFFER, data.vertices.size() * sizeof(MazeVertex), data.vertices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indices.size() * sizeof(unsigned int), data.indices.data(), GL_STATIC_DRAW);
+
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MazeVertex), (void*)0);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MazeVertex), (void*)offsetof(MazeVertex, Normal));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MazeVertex), (void*)offsetof(MazeVertex, TexCoords));
+            glEnableVertexAttribArray(3);
+            glVertexAttribIPointer(3, 4, GL_UNSIGNED_BYTE, sizeof(MazeVertex), (void*)offsetof(MazeVertex, Material));
+
+            std::vector<glm::vec3> positions;
+            positions.reserve(data.vertices.size());
+            for (const MazeVertex &vertex : data.vertices)
+                positions.push_back(vertex.Position);
+            glBindVertexArray(positionVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+            glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+            glBindVertexArray(0);
+        }
+
+        // positionsOnly draws from the position stream, for programs that read nothing but location 0; wallsOnly
+        // leaves out the floor of a greedy mesh, culled meshes draw their walls with DrawCells
+        void Draw(bool positionsOnly = false, bool wallsOnly = false) const {
+            unsigned int count = wallsOnly ? wallIndexCount : indexCount;
+            if (count == 0)
+                return;
+            glBindVertexArray(positionsOnly ? positionVAO : VAO);
+            glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0);
+            rg::frameStats().drawCalls++;
+            rg::frameStats().triangles += count / 3;
+            glBindVertexArray(0);
+        }
+
+        bool hasCellRanges() const {
+            return !cellOffsets.empty();
+        }
+
+        // draws only the cells for which visible(x, z) holds, neighbouring cells are merged into one range
+        template <typename Visible>
+        void DrawCells(Visible visible, bool positionsOnly = false) const {
+            if (!hasCellRanges()) {
+                Draw(positionsOnly);
+                return;
+            }
+            counts.clear();
+            offsets.clear();
+            unsigned int triangles = 0;
+            unsigned int cell = 0;
+            for (int z = cellRect.z0; z < cellRect.z1; z++) {
+                for (int x = cellRect.x0; x < cellRect.x1; x++, cell++) {
+                    unsigned int first = cellOffsets[cell];
+                    unsigned int count = cellOffsets[cell + 1] - first;
+                    if (count == 0 || !visible(x, z))
+                        continue;
+                    if (!counts.empty() && (size_t)offsets.back() / sizeof(unsigned int) + counts.back() == first)
+                        counts.back() += count;
+                    else {
+                        counts.push_back(count);
+                        offsets.push_back((const void*)(first * sizeof(unsigned int)));
+                    }
+                    triangles += count / 3;
+                }
+            }
+            if (counts.empty())
+                return;
+            glBindVertexArray(positionsOnly ? positionVAO : VAO);
+            glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), counts.size());
+            rg::frameStats().drawCalls++;
+            rg::frameStats().triangles += triangles;
+            glBindVertexArray(0);
+        }
+
+        void release() {
+            if (VAO == 0)
+                return;
+            glDeleteVertexArrays(1, &VAO);
+            glDeleteVertexArrays(1, &positionVAO);
+            glDeleteBuffers(1, &VBO);
+            glDeleteBuffers(1, &positionVBO);
+            glDeleteBuffers(1, &EBO);
+            VAO = positionVAO = VBO = positionVBO = EBO = 0;
+            indexCount = wallIndexCount = 0;
+            cellOffsets.clear();
+        }
+
+    private:
+        unsigned int VBO = 0, positionVBO = 0, EBO = 0;
+        MazeRect cellRect{0, 0, 0, 0};
+        std::vector<unsigned int> cellOffsets;
+        mutable std::vector<GLsizei> counts;
+        mutable std::vector<const void*> offsets;
+    };
+
+};
+#endif //PROJECT_BASE_MAZEMESH_H
@@ -0,0 +1,335 @@
+//
+// Created by bambino on 14.2.21..
+//
+
+#ifndef PROJECT_BASE_MAZEWORLD_H
+#define PROJECT_BASE_MAZEWORLD_H
+
+#include <glm/glm.hpp>
+
+#include <rg/Maze.h>
+#include <rg/MazeMesh.h>
+#include <rg/Frustum.h>
+#include <rg/Visibility.h>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace rg {
+
+    // chunkSize x chunkSize cells of the maze with their own buffers, walls and floor together
+    struct MazeChunk {
+        long long key = 0;
+        MazeRect rect{0, 0, 0, 0};
+        MazeMesh mesh;
+        glm::vec3 boundsMin, boundsMax;
+        std::list<long long>::iterator lruEntry;
+    };
+
+    // Splits the maze into chunks whose meshes are built on worker threads around the camera and
+    // uploaded on the GL thread. At most maxResidentChunks stay on the GPU, the least recently
+    // used chunk outside of the streaming radius is evicted first. The capacity is raised when the
+    // radius holds more chunks than that.
+    class MazeWorld {
+    public:
+        MazeWorld(const Maze &maze, MazeMeshMode mode, int chunkSize, unsigned int maxResidentChunks, unsigned int workerCount = 2)
+        : maze(maze), mode(mode), chunkSize(std::max(chunkSize, 1)), maxResidentChunks(std::max(maxResidentChunks, 1u)) {
+            chunksX = (maze.width + this->chunkSize - 1) / this->chunkSize;
+            chunksZ = (maze.height + this->chunkSize - 1) / this->chunkSize;
+            for (unsigned int i = 0; i < std::max(workerCount, 1u); i++)
+                workers.emplace_back(&MazeWorld::workerLoop, this);
+        }
+
+        MazeWorld(const MazeWorld&) = delete;
+        MazeWorld& operator=(const MazeWorld&) = delete;
+
+        ~MazeWorld() {
+            shutdown();
+        }
+
+        // stops the workers and frees the GPU buffers, has to run while the GL context is still alive
+        void shutdown() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            jobReady.notify_all();
+            for (std::thread &worker : workers)
+                worker.join();
+            workers.clear();
+            clear();
+        }
+
+        MazeMeshMode meshMode() const {
+            return mode;
+        }
+
+        // drops every chunk, they are rebuilt with the new mode as they come back into range
+        void setMeshMode(MazeMeshMode newMode) {
+            std::lock_guard<std::mutex> lock(mutex);
+            mode = newMode;
+            generation++;
+            jobs.clear();
+            finished.clear();
+            inFlight.clear();
+            clear();
+        }
+
+        // GL thread: picks the chunks within radius of the camera, queues the missing ones,
+        // uploads finished builds (at most maxUploadsPerFrame) and evicts over capacity
+        void update(const glm::vec3 &cameraPos, float radius, unsigned int maxUploadsPerFrame = 4) {
+            wanted.clear();
+            int cx0 = std::max(0, (int)std::floor((cameraPos.x + 0.5f - radius) / chunkSize));
+            int cz0 = std::max(0, (int)std::floor((cameraPos.z + 0.5f - radius) / chunkSize));
+            int cx1 = std::min(chunksX - 1, (int)std::floor((cameraPos.x + 0.5f + radius) / chunkSize));
+            int cz1 = std::min(chunksZ - 1, (int)std::floor((cameraPos.z + 0.5f + radius) / chunkSize));
+            for (int cz = cz0; cz <= cz1; cz++) {
+                for (int cx = cx0; cx <= cx1; cx++) {
+                    if (distanceToChunk(cameraPos, cx, cz) <= radius)
+                        wanted.push_back(cz * (long long)chunksX + cx);
+                }
+            }
+            std::sort(wanted.begin(), wanted.end(), [&](long long a, long long b) {
+                return distanceToChunk(cameraPos, a % chunksX, a / chunksX) < distanceToChunk(cameraPos, b % chunksX, b / chunksX);
+            });
+            // the chunks inside the radius are never evicted, so the capacity has to hold all of them
+            if (wanted.size() > maxResidentChunks) {
+                if (!capacityRaised)
+                    std::cout << "Maze world: --max-chunks " << maxResidentChunks << " is less than the " << wanted.size()
+                              << " chunks within the stream radius, keeping them all resident" << std::endl;
+                capacityRaised = true;
+                maxResidentChunks = wanted.size();
+            }
+
+            std::vector<Build> ready;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                // replace the queue so chunks that left the radius are not built any more, nearest chunks first
+                jobs.clear();
+                for (long long key : wanted) {
+                    if (resident.count(key) == 0 && inFlight.count(key) == 0 && !isFinished(key))
+                        jobs.push_back(key);
+                }
+
+                unsigned int count = std::min<size_t>(maxUploadsPerFrame, finished.size());
+                ready.assign(std::make_move_iterator(finished.begin()), std::make_move_iterator(finished.begin() + count));
+                finished.erase(finished.begin(), finished.begin() + count);
+            }
+            if (!jobs.empty())
+                jobReady.notify_all();
+
+            for (Build &build : ready)
+                upload(build);
+
+            for (long long key : wanted) {
+                auto chunk = resident.find(key);
+                if (chunk != resident.end())
+                    lru.splice(lru.begin(), lru, chunk->second.lruEntry);
+            }
+            evict();
+
+            occlusion = nullptr;
+            drawList.clear();
+            for (long long key : wanted) {
+                auto chunk = resident.find(key);
+                if (chunk != resident.end())
+                    drawList.push_back(&chunk->second);
+            }
+        }
+
+        // drops the chunks outside of the view frustum from the draw list of this frame
+        void cull(const Frustum &frustum) {
+            bounds.clear();
+            for (const MazeChunk *chunk : drawList)
+                bounds.add(chunk->boundsMin, chunk->boundsMax);
+            unsigned int visibleCount = frustum.cullBoxes(bounds, visible);
+            rg::frameStats().cull.add(drawList.size(), visibleCount);
+
+            unsigned int kept = 0;
+            for (unsigned int i = 0; i < drawList.size(); i++) {
+                if (visible[i])
+                    drawList[kept++] = drawList[i];
+            }
+            drawList.resize(kept);
+        }
+
+        // drops the chunks without a single visible cell; until the next update culled chunks
+        // are also drawn cell by cell, greedy chunks can only be skipped as a whole
+        void cullOccluded(const GridVisibility &visibility) {
+            if (!visibility.isEnabled())
+                return;
+            occlusion = &visibility;
+            unsigned int kept = 0;
+            for (unsigned int i = 0; i < drawList.size(); i++) {
+                if (visibility.anyVisible(drawList[i]->rect))
+                    drawList[kept++] = drawList[i];
+            }
+            rg::frameStats().occlusion.add(drawList.size(), kept);
+            drawList.resize(kept);
+        }
+
+        // draws the resident chunks picked by the last update and cull, one call per chunk whatever the materials,
+        // nearest first so that early depth testing rejects most of the hidden fragments; positionsOnly for depth
+        // only passes, see MazeMesh::Draw
+        void drawMaze(bool positionsOnly = false) const {
+            for (const MazeChunk *chunk : drawList) {
+                if (occlusion)
+                    chunk->mesh.DrawCells([&](int x, int z) { return occlusion->isVisible(x, z); }, positionsOnly);
+                else
+                    chunk->mesh.Draw(positionsOnly);
+                if (!positionsOnly)
+                    rg::frameStats().chunks++;
+            }
+        }
+
+        // the walls without the floor, for the shadow casters
+        void drawWalls(bool positionsOnly = false) const {
+            for (const MazeChunk *chunk : drawList) {
+                if (chunk->mesh.hasCellRanges())
+                    chunk->mesh.DrawCells([&](int x, int z) { return maze.isWall(x, z) && (!occlusion || occlusion->isVisible(x, z)); }, positionsOnly);
+                else
+                    chunk->mesh.Draw(positionsOnly, true);
+            }
+        }
+
+        unsigned int residentCount() const {
+            return resident.size();
+        }
+
+        unsigned int pendingCount() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return jobs.size() + inFlight.size() + finished.size();
+        }
+
+    private:
+        struct Build {
+            long long key;
+            unsigned int generation;
+            MazeMeshData mesh;
+        };
+
+        const Maze &maze;
+        MazeMeshMode mode;
+        int chunkSize;
+        int chunksX = 0, chunksZ = 0;
+        unsigned int maxResidentChunks;
+        bool capacityRaised = false;
+
+        // GL thread only
+        std::unordered_map<long long, MazeChunk> resident;
+        std::list<long long> lru;   // most recently used first
+        std::vector<long long> wanted;
+        std::vector<const MazeChunk*> drawList;
+        const GridVisibility *occlusion = nullptr;
+        AabbBatch bounds;
+        std::vector<unsigned char> visible;
+
+        // shared with the workers, guarded by mutex
+        std::mutex mutex;
+        std::condition_variable jobReady;
+        std::deque<long long> jobs;
+        std::unordered_set<long long> inFlight;
+        std::vector<Build> finished;
+        unsigned int generation = 0;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+
+        MazeRect chunkRect(long long key) const {
+            int cx = key % chunksX;
+            int cz = key / chunksX;
+            return MazeRect{cx * chunkSize, cz * chunkSize, std::min((cx + 1) * chunkSize, maze.width), std::min((cz + 1) * chunkSize, maze.height)};
+        }
+
+        // distance in the xz plane from the camera to the nearest point of the chunk
+        float distanceToChunk(const glm::vec3 &cameraPos, long long cx, long long cz) const {
+            float minX = cx * chunkSize - 0.5f, maxX = (cx + 1) * chunkSize - 0.5f;
+            float minZ = cz * chunkSize - 0.5f, maxZ = (cz + 1) * chunkSize - 0.5f;
+            float dx = std::max(std::max(minX - cameraPos.x, cameraPos.x - maxX), 0.0f);
+            float dz = std::max(std::max(minZ - cameraPos.z, cameraPos.z - maxZ), 0.0f);
+            return std::sqrt(dx * dx + dz * dz);
+        }
+
+        bool isFinished(long long key) const {
+            for (const Build &build : finished) {
+                if (build.key == key)
+                    return true;
+            }
+            return false;
+        }
+
+        void workerLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                jobReady.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (stopping)
+                    return;
+
+                long long key = jobs.front();
+                jobs.pop_front();
+                inFlight.insert(key);
+                unsigned int buildGeneration = generation;
+                MazeMeshMode buildMode = mode;
+                lock.unlock();
+
+                // the maze itself is never written after load, so it can be read without the lock
+                MazeRect rect = chunkRect(key);
+                Build build{key, buildGeneration, buildMazeMesh(maze, buildMode, rect)};
+
+                lock.lock();
+                if (build.generation == generation) {
+                    inFlight.erase(key);
+                    finished.push_back(std::move(build));
+                }
+            }
+        }
+
+        void upload(const Build &build) {
+            if (build.generation != generation || resident.count(build.key) != 0)
+                return;
+            MazeChunk &chunk = resident[build.key];
+            chunk.key = build.key;
+            chunk.rect = chunkRect(build.key);
+            chunk.boundsMin = glm::vec3(chunk.rect.x0 - 0.5f, MAZE_FLOOR_Y, chunk.rect.z0 - 0.5f);
+            chunk.boundsMax = glm::vec3(chunk.rect.x1 - 0.5f, MAZE_FLOOR_Y + MAZE_WALL_HEIGHT, chunk.rect.z1 - 0.5f);
+            chunk.mesh.upload(build.mesh);
+            lru.push_front(build.key);
+            chunk.lruEntry = lru.begin();
+        }
+
+        void evict() {
+            auto candidate = lru.end();
+            while (resident.size() > maxResidentChunks && candidate != lru.begin()) {
+                --candidate;
+                // chunks inside the radius are never evicted, update raised the capacity to cover them
+                if (std::find(wanted.begin(), wanted.end(), *candidate) != wanted.end())
+                    continue;
+                MazeChunk &chunk = resident[*candidate];
+                chunk.mesh.release();
+                resident.erase(*candidate);
+                candidate = lru.erase(candidate);
+            }
+        }
+
+        void clear() {
+            for (auto &entry : resident) {
+                entry.second.mesh.release();
+            }
+            resident.clear();
+            lru.clear();
+            drawList.clear();
+            occlusion = nullptr;
+        }
+    };
+
+};
+#endif //PROJECT_BASE_MAZEWORLD_H
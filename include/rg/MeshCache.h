@@ -0,0 +1,271 @@
+//
+// Created by bambino on 2.3.21..
+//
+
+#ifndef PROJECT_BASE_MESHCACHE_H
+#define PROJECT_BASE_MESHCACHE_H
+
+#include <learnopengl/mesh.h>
+#include <rg/Hash.h>
+#include <rg/MappedFile.h>
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+    // bumped when the file layout, the Vertex or PackedVertex struct or the import flags of Model change, so old files
+    // are imported again
+    const std::uint32_t MESH_CACHE_VERSION = 3;
+    // vertex and index data start on this boundary inside the file
+    const std::uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+    // the sampler name prefixes of Mesh::Draw, stored as their index
+    const char *const MESH_TEXTURE_TYPES[] = {"texture_diffuse", "texture_specular", "texture_normal", "texture_height"};
+    const unsigned int MESH_TEXTURE_TYPE_COUNT = sizeof(MESH_TEXTURE_TYPES) / sizeof(MESH_TEXTURE_TYPES[0]);
+
+    // Mesh file: header, one entry per mesh, the texture references, their names, then the interleaved vertices and
+    // the indices of every mesh. The vertices are in the MeshFormat of the header, a packed file is uploaded as it
+    // is. Read in place from the mapping, the offsets are from the start of the file.
+    struct MeshFileHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t meshCount;
+        std::uint32_t textureCount;
+        std::uint32_t vertexFormat;     // MeshFormat
+        std::uint32_t vertexSize;       // meshVertexSize(vertexFormat) when written
+        std::uint64_t namesOffset;
+        std::uint64_t fileSize;
+    };
+
+    struct MeshFileEntry {
+        std::uint64_t vertexOffset;
+        std::uint64_t indexOffset;
+        std::uint32_t vertexCount;
+        std::uint32_t indexCount;
+        std::uint32_t firstTexture;
+        std::uint32_t textureCount;
+        float bounds[4];            // offset and scale of the packed positions, see packedBounds
+    };
+
+    struct MeshFileTexture {
+        std::uint32_t nameOffset;   // the path as the material has it, relative to the model's directory
+        std::uint32_t nameLength;
+        std::uint32_t type;         // into MESH_TEXTURE_TYPES
+        std::uint32_t padding;
+    };
+
+    // size and modification time of a model and, for an .obj, of the .mtl with the same name that Assimp reads with
+    // it; 0 when the model is missing
+    inline std::uint64_t meshSourceStamp(const std::string &path) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return 0;
+        std::int64_t header[4] = {(std::int64_t)MESH_CACHE_VERSION, (std::int64_t)sizeof(Vertex), (std::int64_t)info.st_size, (std::int64_t)info.st_mtime};
+        std::uint64_t stamp = hashBytes(header, sizeof(header));
+        std::size_t dot = path.find_last_of('.');
+        if (dot != std::string::npos && path.compare(dot, std::string::npos, ".obj") == 0 &&
+            stat((path.substr(0, dot) + ".mtl").c_str(), &info) == 0) {
+            std::int64_t material[2] = {(std::int64_t)info.st_size, (std::int64_t)info.st_mtime};
+            stamp = hashBytes(material, sizeof(material), stamp);
+        }
+        return stamp;
+    }
+
+    // the model path, its stamp and the import options that change the stored meshes, such as the
+    // MeshOptimization; 0 when the model is missing
+    inline std::uint64_t meshCacheKey(const std::string &path, std::uint64_t options = 0) {
+        std::uint64_t stamp = meshSourceStamp(path);
+        if (!stamp)
+            return 0;
+        std::uint64_t key = hashBytes(path.data(), path.size(), stamp);
+        return options ? hashBytes(&options, sizeof(options), key) : key;
+    }
+
+    inline std::string meshCachePath(const std::string &cacheDir, std::uint64_t key) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "mesh_%016llx.bin", (unsigned long long)key);
+        return cacheDir + "/" + name;
+    }
+
+    // the meshes as Model imported them, with the CPU copies of their vertices and indices; the vertices are written
+    // in format, packed ones are packed here once instead of on every load
+    inline bool saveMeshCache(const std::string &path, std::uint64_t key, const std::vector<Mesh> &meshes,
+                              MeshFormat format = MESH_FORMAT_FLOAT) {
+        const std::uint64_t vertexSize = meshVertexSize(format);
+        std::vector<MeshFileEntry> entries;
+        std::vector<MeshFileTexture> textures;
+        std::string names;
+        for (const Mesh &mesh : meshes) {
+            glm::vec4 bounds = format == MESH_FORMAT_PACKED ? meshBounds(mesh.vertices.data(), mesh.vertices.size()) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            entries.push_back(MeshFileEntry{0, 0, (std::uint32_t)mesh.vertices.size(), (std::uint32_t)mesh.indices.size(),
+                                            (std::uint32_t)textures.size(), 0, {bounds.x, bounds.y, bounds.z, bounds.w}});
+            for (const Texture &texture : mesh.textures) {
+                for (unsigned int type = 0; type < MESH_TEXTURE_TYPE_COUNT; type++) {
+                    if (texture.type != MESH_TEXTURE_TYPES[type])
+                        continue;
+                    textures.push_back(MeshFileTexture{(std::uint32_t)names.size(), (std::uint32_t)texture.path.size(), type, 0});
+                    names += texture.path;
+                    entries.back().textureCount++;
+                }
+            }
+        }
+        auto align = [](std::uint64_t offset) {
+            return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+        };
+        std::uint64_t namesOffset = sizeof(MeshFileHeader) + entries.size() * sizeof(MeshFileEntry) + textures.size() * sizeof(MeshFileTexture);
+        std::uint64_t offset = align(namesOffset + names.size());
+        for (MeshFileEntry &entry : entries) {
+            entry.vertexOffset = offset;
+            entry.indexOffset = align(offset + (std::uint64_t)entry.vertexCount * vertexSize);
+            offset = align(entry.indexOffset + (std::uint64_t)entry.indexCount * sizeof(unsigned int));
+        }
+        MeshFileHeader header = {{'R', 'G', 'M', 'S'}, MESH_CACHE_VERSION, key, (std::uint32_t)entries.size(),
+                                 (std::uint32_t)textures.size(), (std::uint32_t)format, (std::uint32_t)vertexSize,
+                                 namesOffset, offset};
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write((const char *)&header, sizeof(header));
+        file.write((const char *)entries.data(), entries.size() * sizeof(MeshFileEntry));
+        file.write((const char *)textures.data(), textures.size() * sizeof(MeshFileTexture));
+        file.write(names.data(), names.size());
+        const char zeros[MESH_CACHE_ALIGNMENT] = {};
+        std::uint64_t written = namesOffset + names.size();
+        for (unsigned int i = 0; i < meshes.size(); i++) {
+            file.write(zeros, entries[i].vertexOffset - written);
+            if (format == MESH_FORMAT_PACKED) {
+                const float *bounds = entries[i].bounds;
+                std::vector<PackedVertex> packed = packVertices(meshes[i].vertices.data(), meshes[i].vertices.size(),
+                                                                glm::vec4(bounds[0], bounds[1], bounds[2], bounds[3]));
+                file.write((const char *)packed.data(), packed.size() * sizeof(PackedVertex));
+            } else {
+                file.write((const char *)meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+            }
+            written = entries[i].vertexOffset + meshes[i].vertices.size() * vertexSize;
+            file.write(zeros, entries[i].indexOffset - written);
+            file.write((const char *)meshes[i].indices.data(), meshes[i].indices.size() * sizeof(unsigned int));
+            written = entries[i].indexOffset + meshes[i].indices.size() * sizeof(unsigned int);
+        }
+        file.write(zeros, offset - written);
+        if (!file) {
+            std::cout << "ERROR::MESH_CACHE::WRITE_FAILED " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // A file written by saveMeshCache, mapped read only; the vertices and indices point into the mapping and go
+    // straight to glBufferData
+    class MeshCacheFile {
+    public:
+        // false when there is no valid file for key at path, the model is then imported again
+        bool open(const std::string &path, std::uint64_t key) {
+            if (!file.open(path))
+                return false;
+            if (file.size() < sizeof(MeshFileHeader) || !valid(key)) {
+                file.close();
+                return false;
+            }
+            return true;
+        }
+
+        unsigned int meshCount() const {
+            return header().meshCount;
+        }
+
+        const MeshFileEntry &mesh(unsigned int index) const {
+            return entries()[index];
+        }
+
+        MeshFormat vertexFormat() const {
+            return (MeshFormat)header().vertexFormat;
+        }
+
+        // only for a MESH_FORMAT_FLOAT file
+        const Vertex *vertices(const MeshFileEntry &entry) const {
+            return (const Vertex *)(file.data() + entry.vertexOffset);
+        }
+
+        // only for a MESH_FORMAT_PACKED file, relative to packedBounds(entry)
+        const PackedVertex *packedVertices(const MeshFileEntry &entry) const {
+            return (const PackedVertex *)(file.data() + entry.vertexOffset);
+        }
+
+        glm::vec4 packedBounds(const MeshFileEntry &entry) const {
+            return glm::vec4(entry.bounds[0], entry.bounds[1], entry.bounds[2], entry.bounds[3]);
+        }
+
+        const unsigned int *indices(const MeshFileEntry &entry) const {
+            return (const unsigned int *)(file.data() + entry.indexOffset);
+        }
+
+        const MeshFileTexture &texture(const MeshFileEntry &entry, unsigned int index) const {
+            return textures()[entry.firstTexture + index];
+        }
+
+        std::string textureName(const MeshFileTexture &texture) const {
+            return std::string(names() + texture.nameOffset, texture.nameLength);
+        }
+
+        std::size_t size() const {
+            return file.size();
+        }
+
+    private:
+        MappedFile file;
+
+        const MeshFileHeader &header() const {
+            return *(const MeshFileHeader *)file.data();
+        }
+
+        const MeshFileEntry *entries() const {
+            return (const MeshFileEntry *)(file.data() + sizeof(MeshFileHeader));
+        }
+
+        const MeshFileTexture *textures() const {
+            return (const MeshFileTexture *)(entries() + header().meshCount);
+        }
+
+        const char *names() const {
+            return (const char *)file.data() + header().namesOffset;
+        }
+
+        // every offset stays inside the file, so a truncated or foreign file is never read past its end
+        bool valid(std::uint64_t key) const {
+            const MeshFileHeader &h = header();
+            std::uint64_t size = file.size();
+            if (std::memcmp(h.magic, "RGMS", 4) != 0 || h.version != MESH_CACHE_VERSION || h.key != key || h.fileSize != size)
+                return false;
+            if ((h.vertexFormat != MESH_FORMAT_FLOAT && h.vertexFormat != MESH_FORMAT_PACKED) ||
+                h.vertexSize != meshVertexSize((MeshFormat)h.vertexFormat))
+                return false;
+            std::uint64_t tables = sizeof(MeshFileHeader) + (std::uint64_t)h.meshCount * sizeof(MeshFileEntry) +
+                                   (std::uint64_t)h.textureCount * sizeof(MeshFileTexture);
+            if (tables > size || h.namesOffset != tables)
+                return false;
+            for (unsigned int i = 0; i < h.meshCount; i++) {
+                const MeshFileEntry &entry = entries()[i];
+                if (entry.vertexOffset + (std::uint64_t)entry.vertexCount * h.vertexSize > size ||
+                    entry.indexOffset + (std::uint64_t)entry.indexCount * sizeof(unsigned int) > size ||
+                    (std::uint64_t)entry.firstTexture + entry.textureCount > h.textureCount || !(entry.bounds[3] > 0.0f))
+                    return false;
+            }
+            for (unsigned int i = 0; i < h.textureCount; i++) {
+                if (h.namesOffset + textures()[i].nameOffset + textures()[i].nameLength > size ||
+                    textures()[i].type >= MESH_TEXTURE_TYPE_COUNT)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+};
+#endif //PROJECT_BASE_MESHCACHE_H
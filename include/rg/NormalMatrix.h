@@ -0,0 +1,69 @@
+//
+// Created by bambino on 21.2.21..
+//
+
+#ifndef PROJECT_BASE_NORMALMATRIX_H
+#define PROJECT_BASE_NORMALMATRIX_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+
+namespace rg {
+
+    // how maze.vs transforms normals, each mode is a separately built program
+    enum NormalMatrixMode {
+        NORMALS_AUTO,               // translation only if the model matrix allows it, otherwise uniform
+        NORMALS_TRANSLATION_ONLY,   // normals are used as they are
+        NORMALS_UNIFORM,            // normalMatrix computed once on the CPU
+        NORMALS_PER_VERTEX          // inverse transpose of model in the vertex shader, the old behaviour
+    };
+
+    // true if the upper 3x3 of m is the identity, i.e. m only moves things
+    inline bool isTranslationOnly(const glm::mat4 &m) {
+        for (int column = 0; column < 3; column++) {
+            for (int row = 0; row < 3; row++) {
+                if (m[column][row] != (column == row ? 1.0f : 0.0f))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    inline NormalMatrixMode resolveNormalMatrixMode(NormalMatrixMode mode, const glm::mat4 &model) {
+        if (mode != NORMALS_AUTO)
+            return mode;
+        return isTranslationOnly(model) ? NORMALS_TRANSLATION_ONLY : NORMALS_UNIFORM;
+    }
+
+    inline glm::mat3 normalMatrix(const glm::mat4 &model) {
+        return glm::mat3(glm::transpose(glm::inverse(model)));
+    }
+
+    // defines for Shader that select the variant
+    inline std::string normalMatrixDefines(NormalMatrixMode mode) {
+        switch (mode) {
+            case NORMALS_TRANSLATION_ONLY:
+                return "#define NORMALS_TRANSLATION_ONLY\n";
+            case NORMALS_PER_VERTEX:
+                return "#define NORMALS_PER_VERTEX\n";
+            default:
+                return "";
+        }
+    }
+
+    inline const char *normalMatrixModeName(NormalMatrixMode mode) {
+        switch (mode) {
+            case NORMALS_TRANSLATION_ONLY:
+                return "translation";
+            case NORMALS_UNIFORM:
+                return "uniform";
+            case NORMALS_PER_VERTEX:
+                return "per-vertex";
+            default:
+                return "auto";
+        }
+    }
+
+};
+#endif //PROJECT_BASE_NORMALMATRIX_H
@@ -0,0 +1,225 @@
+//
+// Created by bambino on 12.2.21..
+//
+
+#ifndef PROJECT_BASE_SETTINGS_H
+#define PROJECT_BASE_SETTINGS_H
+
+#include <learnopengl/mesh.h>
+#include <rg/DeferredRenderer.h>
+#include <rg/VertexCacheOptimizer.h>
+#include <rg/LightGrid.h>
+#include <rg/MazeMesh.h>
+#include <rg/NormalMatrix.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace rg {
+
+    // startup options, see printUsage for the command line flags
+    struct Settings {
+        std::string mapPath = "src/map.txt";
+        int generateSize = 0;       // when > 0 a generateSize x generateSize maze is generated instead of loading mapPath
+        unsigned int seed = 1;
+        MazeMeshMode meshMode = MAZE_MESH_GREEDY;
+        int chunkSize = 32;                 // cells per chunk side
+        unsigned int maxResidentChunks = 256;
+        float streamRadius = 100.0f;        // chunks closer than this to the camera are kept loaded, matches the far plane
+        bool occlusion = true;              // only draw the cells the grid visibility pass can see
+        NormalMatrixMode normalMode = NORMALS_AUTO;
+        int lanternSpacing = 0;             // when > 0 a lantern stands in every lanternSpacing x lanternSpacing block of cells
+        LightCulling lightCulling = LIGHT_CULLING_CELLS;
+        RenderPath renderPath = RENDER_FORWARD;
+        bool lightmap = true;               // bake the static lantern light instead of computing it per fragment
+        bool shadows = true;                // shadow maps for the spot light and, without the lightmap, the lanterns
+        unsigned int shadowMemoryMB = 64;   // all shadow maps together, lanterns nearest to the camera first
+        bool depthPrepass = true;           // forward path: depth only pass first, then the lit pass with GL_EQUAL
+        bool overdraw = false;              // forward path: show how often each pixel is lit instead of the maze
+        unsigned int textureThreads = 4;    // image decoding threads, 0 decodes every texture before the first frame
+        bool texturePixelBuffers = true;    // upload the decoded images through a pixel buffer
+        bool textureCache = true;           // S3TC compressed textures with their mips, cached in cache/
+        bool texturePack = true;            // read the textures in resources/textures.pack from there
+        bool meshCache = true;              // models are read from cache/ after their first import
+        MeshRetention meshRetention = MESH_RETAIN_NONE;    // CPU copy the models keep after the upload
+        MeshFormat meshFormat = MESH_FORMAT_PACKED;         // vertex layout of the models on the GPU
+        MeshOptimization meshOptimization = MESH_OPTIMIZE_CACHE;    // triangle order of the models, set at import
+        std::string benchmark;              // when set the named benchmark runs instead of the maze
+    };
+
+    inline void printUsage(const char *program) {
+        std::cout << "usage: " << program << " [options]\n"
+                  << "  --map <path>             load the maze from a map file (default src/map.txt,\n"
+                  << "                           resources/maps/variants.txt shows the material variants)\n"
+                  << "  --generate <size>        generate a size x size maze instead of loading a map\n"
+                  << "  --seed <n>               seed for --generate\n"
+                  << "  --mesh <mode>            maze mesh builder: culled, greedy or cubes (default greedy, G cycles)\n"
+                  << "  --chunk-size <cells>     side of a streamed maze chunk (default 32)\n"
+                  << "  --max-chunks <n>         chunks kept on the GPU at most (default 256)\n"
+                  << "  --stream-radius <units>  distance around the camera in which chunks are loaded (default 100)\n"
+                  << "  --occlusion <on|off>     grid visibility culling of walls, floor and lanterns (default on)\n"
+                  << "  --normals <mode>         auto, translation, uniform or per-vertex normal transform (default auto)\n"
+                  << "  --lantern-spacing <cells> a lantern every few cells instead of the five of the default map\n"
+                  << "  --light-culling <mode>   cells (walls block lanterns) or clusters (default cells)\n"
+                  << "  --lightmap <on|off>      baked lantern light, cached in cache/ (default on)\n"
+                  << "  --shadows <on|off>       spot light and lantern shadow maps (default on)\n"
+                  << "  --shadow-memory <MB>     memory for all shadow maps (default 64)\n"
+                  << "  --prepass <on|off>       depth prepass before the lit maze pass (default on, P toggles)\n"
+                  << "  --overdraw <on|off>      show the lit fragments per pixel (default off, O toggles)\n"
+                  << "  --textures <sync|async>  decode the textures on worker threads behind placeholders (default async)\n"
+                  << "  --texture-threads <n>    image decoding threads of --textures async (default 4)\n"
+                  << "  --texture-pbo <on|off>   upload the textures through a pixel buffer (default on)\n"
+                  << "  --texture-cache <on|off> block compressed textures, cached in cache/ (default on)\n"
+                  << "  --texture-pack <on|off>  upload from resources/textures.pack when it exists (default on)\n"
+                  << "  --mesh-cache <on|off>    imported models, cached in cache/ (default on)\n"
+                  << "  --mesh-data <mode>       model geometry kept on the CPU: none, positions or all (default none)\n"
+                  << "  --mesh-format <format>   model vertices: float (56 bytes) or packed (16 bytes, default)\n"
+                  << "  --mesh-optimize <mode>   model triangle order at import: off, cache or overdraw (default cache)\n"
+                  << "  --renderer <mode>        forward or deferred shading (default forward)\n"
+                  << "  --bench <name>           print a benchmark and exit: uniforms, normals, meshes, occlusion,\n"
+                  << "                           lights, renderers, models, vertices\n";
+    }
+
+    // returns false when the program should exit, e.g. after --help or an unknown flag
+    inline bool parseSettings(int argc, char **argv, Settings &settings) {
+        for (int i = 1; i < argc; i++) {
+            const char *arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (std::strcmp(arg, "--map") == 0 && hasValue) {
+                settings.mapPath = argv[++i];
+            } else if (std::strcmp(arg, "--generate") == 0 && hasValue) {
+                settings.generateSize = std::atoi(argv[++i]);
+            } else if (std::strcmp(arg, "--seed") == 0 && hasValue) {
+                settings.seed = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+            } else if (std::strcmp(arg, "--mesh") == 0 && hasValue) {
+                std::string mode = argv[++i];
+                if (mode == "culled")
+                    settings.meshMode = MAZE_MESH_CULLED;
+                else if (mode == "greedy")
+                    settings.meshMode = MAZE_MESH_GREEDY;
+                else if (mode == "cubes")
+                    settings.meshMode = MAZE_MESH_CUBES;
+                else {
+                    std::cout << "ERROR::SETTINGS::UNKNOWN_MESH_MODE " << mode << std::endl;
+                    return false;
+                }
+            } else if (std::strcmp(arg, "--chunk-size") == 0 && hasValue) {
+                settings.chunkSize = std::atoi(argv[++i]);
+            } else if (std::strcmp(arg, "--max-chunks") == 0 && hasValue) {
+                settings.maxResidentChunks = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+            } else if (std::strcmp(arg, "--stream-radius") == 0 && hasValue) {
+                settings.streamRadius = (float)std::atof(argv[++i]);
+            } else if (std::strcmp(arg, "--occlusion") == 0 && hasValue) {
+                settings.occlusion = std::strcmp(argv[++i], "off") != 0;
+            } else if (std::strcmp(arg, "--normals") == 0 && hasValue) {
+                std::string mode = argv[++i];
+                if (mode == "auto")
+                    settings.normalMode = NORMALS_AUTO;
+                else if (mode == "translation")
+                    settings.normalMode = NORMALS_TRANSLATION_ONLY;
+                else if (mode == "uniform")
+                    settings.normalMode = NORMALS_UNIFORM;
+                else if (mode == "per-vertex")
+                    settings.normalMode = NORMALS_PER_VERTEX;
+                else {
+                    std::cout << "ERROR::SETTINGS::UNKNOWN_NORMALS_MODE " << mode << std::endl;
+                    return false;
+                }
+            } else if (std::strcmp(arg, "--lantern-spacing") == 0 && hasValue) {
+                settings.lanternSpacing = std::atoi(argv[++i]);
+            } else if (std::strcmp(arg, "--light-culling") == 0 && hasValue) {
+                std::string mode = argv[++i];
+                if (mode == "cells")
+                    settings.lightCulling = LIGHT_CULLING_CELLS;
+                else if (mode == "clusters")
+                    settings.lightCulling = LIGHT_CULLING_CLUSTERS;
+                else {
+                    std::cout << "ERROR::SETTINGS::UNKNOWN_LIGHT_CULLING " << mode << std::endl;
+                    return false;
+                }
+            } else if (std::strcmp(arg, "--lightmap") == 0 && hasValue) {
+                settings.lightmap = std::strcmp(argv[++i], "off") != 0;
+            } else if (std::strcmp(arg, "--shadows") == 0 && hasValue) {
+                settings.shadows = std::strcmp(argv[++i], "off") != 0;
+            } else if (std::strcmp(arg, "--shadow-memory") == 0 && hasValue) {
+                settings.shadowMemoryMB = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+            } else if (std::strcmp(arg, "--prepass") == 0 && hasValue) {
+                settings.depthPrepass = std::strcmp(argv[++i], "off") != 0;
+            } else if (std::strcmp(arg, "--overdraw") == 0 && hasValue) {
+                settings.overdraw = std::strcmp(argv[++i], "off") != 0;
+            } else if (std::strcmp(arg, "--textures") == 0 && hasValue) {
+                if (std::strcmp(argv[++i], "sync") == 0)
+                    settings.textureThreads = 0;
+                else if (settings.textureThreads == 0)
+                    settings.textureThreads = 4;
+            } else if (std::strcmp(arg, "--texture-threads") == 0 && hasValue) {
+                settings.textureThreads = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+            } else if (std::strcmp(arg, "--texture-pbo") == 0 && hasValue) {
+                settings.texturePixelBuffers = std::strcmp(argv[++i], "off") != 0;
+            } else if (std::strcmp(arg, "--texture-cache") == 0 && hasValue) {
+                settings.textureCache = std::strcmp(argv[++i], "off") != 0;
+            } else if (std::strcmp(arg, "--texture-pack") == 0 && hasValue) {
+                settings.texturePack = std::strcmp(argv[++i], "off") != 0;
+            } else if (std::strcmp(arg, "--mesh-cache") == 0 && hasValue) {
+                settings.meshCache = std::strcmp(argv[++i], "off") != 0;
+            } else if (std::strcmp(arg, "--mesh-data") == 0 && hasValue) {
+                std::string mode = argv[++i];
+                if (mode == "none")
+                    settings.meshRetention = MESH_RETAIN_NONE;
+                else if (mode == "positions")
+                    settings.meshRetention = MESH_RETAIN_POSITIONS;
+                else if (mode == "all")
+                    settings.meshRetention = MESH_RETAIN_ALL;
+                else {
+                    std::cout << "ERROR::SETTINGS::UNKNOWN_MESH_DATA " << mode << std::endl;
+                    return false;
+                }
+            } else if (std::strcmp(arg, "--mesh-format") == 0 && hasValue) {
+                std::string format = argv[++i];
+                if (format == "float")
+                    settings.meshFormat = MESH_FORMAT_FLOAT;
+                else if (format == "packed")
+                    settings.meshFormat = MESH_FORMAT_PACKED;
+                else {
+                    std::cout << "ERROR::SETTINGS::UNKNOWN_MESH_FORMAT " << format << std::endl;
+                    return false;
+                }
+            } else if (std::strcmp(arg, "--mesh-optimize") == 0 && hasValue) {
+                std::string mode = argv[++i];
+                if (mode == "off")
+                    settings.meshOptimization = MESH_OPTIMIZE_NONE;
+                else if (mode == "cache")
+                    settings.meshOptimization = MESH_OPTIMIZE_CACHE;
+                else if (mode == "overdraw")
+                    settings.meshOptimization = MESH_OPTIMIZE_OVERDRAW;
+                else {
+                    std::cout << "ERROR::SETTINGS::UNKNOWN_MESH_OPTIMIZATION " << mode << std::endl;
+                    return false;
+                }
+            } else if (std::strcmp(arg, "--renderer") == 0 && hasValue) {
+                std::string mode = argv[++i];
+                if (mode == "forward")
+                    settings.renderPath = RENDER_FORWARD;
+                else if (mode == "deferred")
+                    settings.renderPath = RENDER_DEFERRED;
+                else {
+                    std::cout << "ERROR::SETTINGS::UNKNOWN_RENDERER " << mode << std::endl;
+                    return false;
+                }
+            } else if (std::strcmp(arg, "--bench") == 0 && hasValue) {
+                settings.benchmark = argv[++i];
+            } else {
+                if (std::strcmp(arg, "--help") != 0)
+                    std::cout << "ERROR::SETTINGS::UNKNOWN_OPTION " << arg << std::endl;
+                printUsage(argv[0]);
+                return false;
+            }
+        }
+        return true;
+    }
+
+};
+#endif //PROJECT_BASE_SETTINGS_H
@@ -0,0 +1,389 @@
+//
+// Created by bambino on 26.2.21..
+//
+
+#ifndef PROJECT_BASE_SHADOWMAPS_H
+#define PROJECT_BASE_SHADOWMAPS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <rg/ClusteredLights.h>
+#include <rg/FrameStats.h>
+#include <rg/Maze.h>
+#include <rg/MazeMesh.h>
+#include <rg/SurfaceLighting.h>
+#include <rg/UniformBuffer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+    // texture units of the shadow maps; above the 16 units a single stage must support, a maze program still
+    // samples fewer than 16 textures at once, see resources/shaders/shadows.glsl
+    const int LANTERN_SHADOW_UNIT = 16;
+    const int SHADOW_SLOT_UNIT = 17;
+    const int SPOT_SHADOW_UNIT = 18;
+
+    const int LANTERN_SHADOW_SIZE = 256;    // texels per cube face side
+    const int SPOT_SHADOW_SIZE = 1024;
+    const float SPOT_SHADOW_NEAR = 0.1f;
+    const float SPOT_SHADOW_FAR = 40.0f;    // the spot light is too dim to matter further away
+
+    // where the spot light is held, in camera space: right of and below the eye, so the shadows it casts can be seen
+    const glm::vec3 SPOT_HAND_OFFSET(0.25f, -0.2f, 0.0f);
+
+    // forward and up of the six cube faces, keep in sync with resources/shaders/shadows.glsl
+    const glm::vec3 SHADOW_FACE_FORWARD[6] = {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+                                              glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)};
+    const glm::vec3 SHADOW_FACE_UP[6] = {glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+                                         glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0)};
+
+    inline std::string shadowDefines(bool enabled) {
+        return enabled ? "#define SHADOWS\n" : "";
+    }
+
+    // Shadow maps of the lanterns and the camera spot light. Neither the lanterns nor the walls move, so a lantern's
+    // cube map is rendered once when it gets a slot and kept until a lantern nearer to the camera needs the slot.
+    // The slots live in one depth texture array, six layers each, sized to fit the memory budget. Only the spot light
+    // moves with the camera, its map is rendered every frame from the chunks and lanterns drawn that frame.
+    class ShadowMaps {
+    public:
+        ShadowMaps()
+                : cubeShader("resources/shaders/shadow_cube.vs", "resources/shaders/shadow_cube.fs"),
+                  spotShader("resources/shaders/shadow_spot.vs", "resources/shaders/shadow_spot.fs") {
+        }
+
+        // memoryBytes covers both maps; the lanterns get what the spot map leaves, none when lanternShadows is false
+        void create(unsigned int lightCount, std::size_t memoryBytes, bool lanternShadows) {
+            spotShader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+            std::size_t spotBytes = (std::size_t)SPOT_SHADOW_SIZE * SPOT_SHADOW_SIZE * 4;
+            std::size_t slotBytes = lanternSlotBytes();
+            GLint maxLayers = 0;
+            glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+            slots = 0;
+            if (lanternShadows && memoryBytes > spotBytes)
+                slots = (unsigned int)std::min<std::size_t>(std::min<std::size_t>((memoryBytes - spotBytes) / slotBytes, maxLayers / 6), lightCount);
+            if (memoryBytes < spotBytes)
+                std::cout << "ERROR::SHADOWS::MEMORY_BELOW_SPOT_MAP " << spotBytes / (1024 * 1024) << " MB" << std::endl;
+            bytes = spotBytes + slots * slotBytes;
+
+            // hardware depth comparison with linear filtering, every tap of the shader is already a 2x2 PCF
+            auto depthParameters = [](GLenum target) {
+                glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+                glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+                float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+                glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, border);
+                glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+                glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+            };
+
+            // a 1 texel array when no lantern is shadowed, so the sampler still has a complete texture
+            glGenTextures(1, &lanternMaps);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, lanternMaps);
+            int size = slots ? LANTERN_SHADOW_SIZE : 1;
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT16, size, size, std::max(slots, 1u) * 6, 0,
+                         GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, nullptr);
+            depthParameters(GL_TEXTURE_2D_ARRAY);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+            glGenTextures(1, &spotMap);
+            glBindTexture(GL_TEXTURE_2D, spotMap);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SPOT_SHADOW_SIZE, SPOT_SHADOW_SIZE, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+            depthParameters(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            // depth only framebuffers, the cube faces are attached one layer at a time
+            glGenFramebuffers(1, &cubeFBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, cubeFBO);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+            glGenFramebuffers(1, &spotFBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, spotFBO);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, spotMap, 0);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::SHADOWS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            lightSlot.assign(lightCount, -1);
+            slotOwner.assign(slots, -1);
+            slotFrame.assign(slots, 0);
+            slotBuffer.create(GL_R32I);
+            slotBuffer.upload(lightSlot.data(), lightSlot.size() * sizeof(int), GL_DYNAMIC_DRAW);
+            createBlock();
+        }
+
+        void release() {
+            if (lanternMaps) {
+                glDeleteTextures(1, &lanternMaps);
+                glDeleteTextures(1, &spotMap);
+                glDeleteFramebuffers(1, &cubeFBO);
+                glDeleteFramebuffers(1, &spotFBO);
+                glDeleteVertexArrays(1, &blockVAO);
+                glDeleteBuffers(1, &blockVBO);
+                glDeleteBuffers(1, &blockEBO);
+                glDeleteBuffers(1, &instanceVBO);
+            }
+            lanternMaps = spotMap = cubeFBO = spotFBO = blockVAO = blockVBO = blockEBO = instanceVBO = 0;
+            slotBuffer.release();
+        }
+
+        // samplers of a program built with SHADOWS
+        void setUniforms(const Shader &shader) const {
+            shader.use();
+            shader.setInt("lanternShadows", LANTERN_SHADOW_UNIT);
+            shader.setInt("lanternShadowSlots", SHADOW_SLOT_UNIT);
+            shader.setInt("spotShadow", SPOT_SHADOW_UNIT);
+        }
+
+        // Gives the slots to the lanterns nearest to the camera within reach and renders the ones that just got one,
+        // at most maxRenders (0 for no limit), the others follow in the next frames. Returns the maps rendered.
+        unsigned int updateLanterns(const Maze &maze, const LightClusters &lights, const glm::vec3 &cameraPos, float reach,
+                                    unsigned int maxRenders = 0) {
+            if (slots == 0)
+                return 0;
+            // the order only changes when the camera enters another cell
+            int cellX = (int)std::round(cameraPos.x), cellZ = (int)std::round(cameraPos.z);
+            if (!pending && cellX == lastCellX && cellZ == lastCellZ)
+                return 0;
+            lastCellX = cellX;
+            lastCellZ = cellZ;
+
+            lights.gatherNearby(cameraPos, reach, nearby);
+            auto nearer = [&](unsigned int a, unsigned int b) {
+                glm::vec3 da = lights.lightPosition(a) - cameraPos, db = lights.lightPosition(b) - cameraPos;
+                return da.x * da.x + da.z * da.z < db.x * db.x + db.z * db.z;
+            };
+            unsigned int wanted = std::min<std::size_t>(slots, nearby.size());
+            std::partial_sort(nearby.begin(), nearby.begin() + wanted, nearby.end(), nearer);
+
+            frame++;
+            for (unsigned int i = 0; i < wanted; i++) {
+                if (lightSlot[nearby[i]] >= 0)
+                    slotFrame[lightSlot[nearby[i]]] = frame;
+            }
+            unsigned int rendered = 0;
+            unsigned int freeSlot = 0;
+            pending = false;
+            for (unsigned int i = 0; i < wanted; i++) {
+                unsigned int light = nearby[i];
+                if (lightSlot[light] >= 0)
+                    continue;
+                if (maxRenders && rendered == maxRenders) {
+                    pending = true;
+                    break;
+                }
+                // a slot whose lantern is not wanted any more, there is one for every wanted lantern
+                while (slotFrame[freeSlot] == frame)
+                    freeSlot++;
+                if (slotOwner[freeSlot] >= 0)
+                    lightSlot[slotOwner[freeSlot]] = -1;
+                slotOwner[freeSlot] = light;
+                slotFrame[freeSlot] = frame;
+                lightSlot[light] = freeSlot;
+                renderLantern(maze, lights, light, freeSlot);
+                rendered++;
+            }
+            if (rendered)
+                slotBuffer.upload(lightSlot.data(), lightSlot.size() * sizeof(int), GL_DYNAMIC_DRAW);
+            shadowed = 0;
+            for (unsigned int i = 0; i < wanted; i++)
+                shadowed += lightSlot[nearby[i]] >= 0;
+            return rendered;
+        }
+
+        // the spot light of this frame, call before FrameData is uploaded
+        void setSpotLight(const glm::vec3 &position, const glm::vec3 &direction) {
+            glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            // the map covers the outer cone with a little room for the PCF taps
+            float fov = 2.0f * SPOT_OUTER_CUT_OFF_DEGREES + 4.0f;
+            spotMatrix = glm::perspective(glm::radians(fov), 1.0f, SPOT_SHADOW_NEAR, SPOT_SHADOW_FAR) *
+                         glm::lookAt(position, position + direction, up);
+        }
+
+        void fillFrameData(FrameData &frameData) const {
+            frameData.spotShadowMatrix = spotMatrix;
+        }
+
+        // binds the spot map for writing and returns the program to draw its casters with; FrameData has to be current
+        Shader &beginSpot() {
+            glGetIntegerv(GL_VIEWPORT, savedViewport);
+            blendWasEnabled = glIsEnabled(GL_BLEND);
+            glBindFramebuffer(GL_FRAMEBUFFER, spotFBO);
+            glViewport(0, 0, SPOT_SHADOW_SIZE, SPOT_SHADOW_SIZE);
+            glDisable(GL_BLEND);
+            glEnable(GL_DEPTH_TEST);
+            glDepthMask(GL_TRUE);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            // the maze meshes do not all have closed backs, so both sides are drawn and the bias is left to the shader
+            glEnable(GL_POLYGON_OFFSET_FILL);
+            glPolygonOffset(1.5f, 4.0f);
+            spotShader.use();
+            spotShader.setMat4("model", glm::mat4(1.0f));
+            spotShader.setVec4("meshBounds", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+            return spotShader;
+        }
+
+        void endSpot() {
+            glDisable(GL_POLYGON_OFFSET_FILL);
+            restore();
+        }
+
+        void bind() const {
+            glActiveTexture(GL_TEXTURE0 + LANTERN_SHADOW_UNIT);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, lanternMaps);
+            slotBuffer.bind(SHADOW_SLOT_UNIT);
+            glActiveTexture(GL_TEXTURE0 + SPOT_SHADOW_UNIT);
+            glBindTexture(GL_TEXTURE_2D, spotMap);
+        }
+
+        unsigned int slotCount() const {
+            return slots;
+        }
+
+        // lanterns that had a slot after the last update
+        unsigned int shadowedCount() const {
+            return shadowed;
+        }
+
+        std::size_t memoryBytes() const {
+            return bytes;
+        }
+
+        static std::size_t lanternSlotBytes() {
+            return (std::size_t)LANTERN_SHADOW_SIZE * LANTERN_SHADOW_SIZE * 2 * 6;
+        }
+
+    private:
+        Shader cubeShader;
+        Shader spotShader;
+        unsigned int lanternMaps = 0, spotMap = 0;
+        unsigned int cubeFBO = 0, spotFBO = 0;
+        unsigned int blockVAO = 0, blockVBO = 0, blockEBO = 0, instanceVBO = 0;
+        TextureBuffer slotBuffer;   // per light: its slot in lanternMaps, -1 when it casts no shadow
+        unsigned int slots = 0;
+        std::size_t bytes = 0;
+        glm::mat4 spotMatrix = glm::mat4(1.0f);
+
+        std::vector<int> lightSlot;
+        std::vector<int> slotOwner;
+        std::vector<unsigned int> slotFrame;    // last update that wanted the slot's lantern
+        unsigned int frame = 0;
+        bool pending = false;
+        int lastCellX = -1, lastCellZ = -1;
+        unsigned int shadowed = 0;
+
+        // kept to avoid reallocating
+        std::vector<unsigned int> nearby;
+        std::vector<glm::vec2> blocks;
+
+        GLint savedViewport[4] = {0, 0, 0, 0};
+        GLboolean blendWasEnabled = GL_TRUE;
+
+        // Six faces of the lantern's cube into its layers. Every wall cell in reach is one instance of a wall block,
+        // and only the back faces are drawn, so the stored depth is that of the far side of a wall and the lit side
+        // never shadows itself. The depth is the distance to the lantern over its radius, see shadow_cube.fs.
+        void renderLantern(const Maze &maze, const LightClusters &lights, unsigned int light, unsigned int slot) {
+            const glm::vec3 &position = lights.lightPosition(light);
+            float radius = lights.lightRadius();
+            int lightX = (int)std::round(position.x), lightZ = (int)std::round(position.z);
+            int reach = (int)std::ceil(radius) + 1;
+            blocks.clear();
+            for (int z = lightZ - reach; z <= lightZ + reach; z++) {
+                for (int x = lightX - reach; x <= lightX + reach; x++) {
+                    // a lantern inside a wall would only see the inside of its own block
+                    if ((x == lightX && z == lightZ) || !maze.isWall(x, z))
+                        continue;
+                    float dx = std::max(std::abs(x - position.x) - 0.5f, 0.0f), dz = std::max(std::abs(z - position.z) - 0.5f, 0.0f);
+                    if (dx * dx + dz * dz < radius * radius)
+                        blocks.push_back(glm::vec2(x, z));
+                }
+            }
+
+            glGetIntegerv(GL_VIEWPORT, savedViewport);
+            blendWasEnabled = glIsEnabled(GL_BLEND);
+            glBindFramebuffer(GL_FRAMEBUFFER, cubeFBO);
+            glViewport(0, 0, LANTERN_SHADOW_SIZE, LANTERN_SHADOW_SIZE);
+            glDisable(GL_BLEND);
+            glEnable(GL_DEPTH_TEST);
+            glDepthMask(GL_TRUE);
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_FRONT);
+
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glBufferData(GL_ARRAY_BUFFER, blocks.size() * sizeof(glm::vec2), blocks.data(), GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            cubeShader.use();
+            cubeShader.setVec4("lightPositionRadius", glm::vec4(position, radius));
+            glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, radius);
+            glBindVertexArray(blockVAO);
+            for (int face = 0; face < 6; face++) {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, lanternMaps, 0, slot * 6 + face);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                if (blocks.empty())
+                    continue;
+                cubeShader.setMat4("faceViewProjection", projection * glm::lookAt(position, position + SHADOW_FACE_FORWARD[face], SHADOW_FACE_UP[face]));
+                glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0, blocks.size());
+                frameStats().drawCalls++;
+                frameStats().triangles += 12 * blocks.size();
+            }
+            glBindVertexArray(0);
+
+            glCullFace(GL_BACK);
+            glDisable(GL_CULL_FACE);
+            restore();
+        }
+
+        void restore() {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+            if (blendWasEnabled)
+                glEnable(GL_BLEND);
+        }
+
+        // one wall cell from the floor to the wall tops around the origin, counter-clockwise seen from outside
+        void createBlock() {
+            float y0 = MAZE_FLOOR_Y, y1 = MAZE_FLOOR_Y + MAZE_WALL_HEIGHT;
+            float vertices[] = {
+                    -0.5f, y0, -0.5f,   0.5f, y0, -0.5f,   0.5f, y0, 0.5f,   -0.5f, y0, 0.5f,
+                    -0.5f, y1, -0.5f,   0.5f, y1, -0.5f,   0.5f, y1, 0.5f,   -0.5f, y1, 0.5f};
+            unsigned short indices[] = {
+                    0, 1, 2, 0, 2, 3,       // bottom
+                    4, 6, 5, 4, 7, 6,       // top
+                    0, 4, 5, 0, 5, 1,       // -z
+                    3, 2, 6, 3, 6, 7,       // +z
+                    0, 3, 7, 0, 7, 4,       // -x
+                    1, 5, 6, 1, 6, 2};      // +x
+            glGenVertexArrays(1, &blockVAO);
+            glGenBuffers(1, &blockVBO);
+            glGenBuffers(1, &blockEBO);
+            glGenBuffers(1, &instanceVBO);
+            glBindVertexArray(blockVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, blockVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, blockEBO);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+            glVertexAttribDivisor(1, 1);
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    };
+
+};
+#endif //PROJECT_BASE_SHADOWMAPS_H
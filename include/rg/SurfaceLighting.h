@@ -0,0 +1,67 @@
+//
+// Created by bambino on 24.2.21..
+//
+
+#ifndef PROJECT_BASE_SURFACELIGHTING_H
+#define PROJECT_BASE_SURFACELIGHTING_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <rg/MazeMaterials.h>
+#include <rg/UniformId.h>
+
+#include <cmath>
+
+namespace rg {
+
+    // how a maze material reacts to the lanterns and the spot light, see resources/shaders/lighting.glsl
+    struct SurfaceLighting {
+        glm::vec3 pointAmbient, pointDiffuse, pointSpecular;
+        glm::vec3 spotAmbient, spotDiffuse, spotSpecular;
+        float spotConstant, spotLinear, spotQuadratic;
+        float shininess;
+    };
+
+    // the spot light cone of the camera, the same for every material
+    const float SPOT_CUT_OFF_DEGREES = 12.5f;
+    const float SPOT_OUTER_CUT_OFF_DEGREES = 15.0f;
+
+    const SurfaceLighting WALL_LIGHTING{
+            glm::vec3(0.005f, 0.005f, 0.005f), glm::vec3(0.45f, 0.45f, 0.0f), glm::vec3(0.3f, 0.3f, 0.0f),
+            glm::vec3(0.0f), glm::vec3(0.4f), glm::vec3(0.04f),
+            1.0f, 0.045f, 0.0075f,
+            4.0f};
+
+    const SurfaceLighting FLOOR_LIGHTING{
+            glm::vec3(0.005f, 0.005f, 0.0f), glm::vec3(0.4f, 0.4f, 0.0f), glm::vec3(0.05f, 0.05f, 0.0f),
+            glm::vec3(0.0f), glm::vec3(0.6f), glm::vec3(0.04f),
+            1.0f, 0.14f, 0.07f,
+            10.0f};
+
+    // the uniforms of one material: pointLightColor, spotLight and materialShininess, arrays indexed by material id
+    // in maze.fs and the deferred lighting passes; a program only has the arrays it uses, missing ones are ignored
+    inline void setSurfaceLighting(const Shader &shader, const SurfaceLighting &lighting, int material) {
+        shader.use();
+        shader.setVec3(uniformAt("pointLightColor", material, "ambient"), lighting.pointAmbient);
+        shader.setVec3(uniformAt("pointLightColor", material, "diffuse"), lighting.pointDiffuse);
+        shader.setVec3(uniformAt("pointLightColor", material, "specular"), lighting.pointSpecular);
+        shader.setVec3(uniformAt("spotLight", material, "ambient"), lighting.spotAmbient);
+        shader.setVec3(uniformAt("spotLight", material, "diffuse"), lighting.spotDiffuse);
+        shader.setVec3(uniformAt("spotLight", material, "specular"), lighting.spotSpecular);
+        shader.setFloat(uniformAt("spotLight", material, "constant"), lighting.spotConstant);
+        shader.setFloat(uniformAt("spotLight", material, "linear"), lighting.spotLinear);
+        shader.setFloat(uniformAt("spotLight", material, "quadratic"), lighting.spotQuadratic);
+        shader.setFloat(uniformAt("spotLight", material, "cutOff"), std::cos(glm::radians(SPOT_CUT_OFF_DEGREES)));
+        shader.setFloat(uniformAt("spotLight", material, "outerCutOff"), std::cos(glm::radians(SPOT_OUTER_CUT_OFF_DEGREES)));
+        shader.setFloat(uniformAt("materialShininess", material), lighting.shininess);
+    }
+
+    // the walls and the floor
+    inline void setMazeLighting(const Shader &shader) {
+        setSurfaceLighting(shader, WALL_LIGHTING, MATERIAL_WALL);
+        setSurfaceLighting(shader, FLOOR_LIGHTING, MATERIAL_FLOOR);
+    }
+
+};
+#endif //PROJECT_BASE_SURFACELIGHTING_H
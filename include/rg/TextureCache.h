@@ -0,0 +1,334 @@
+//
+// Created by bambino on 28.2.21..
+//
+
+#ifndef PROJECT_BASE_TEXTURECACHE_H
+#define PROJECT_BASE_TEXTURECACHE_H
+
+#include <glad/glad.h>
+
+#include <rg/Hash.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// EXT_texture_compression_s3tc, not part of the generated glad loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace rg {
+
+    // bumped when the encoder or the file layout changes, so old cache files are compressed again
+    const std::uint32_t TEXTURE_CACHE_VERSION = 1;
+
+    // BC1 (DXT1) for images without alpha, BC3 (DXT5) for the ones with it, every mip level down to 1x1
+    struct CompressedImage {
+        GLenum format = 0;
+        int width = 0, height = 0;
+        std::vector<std::vector<unsigned char>> levels;
+
+        bool empty() const {
+            return levels.empty();
+        }
+
+        std::size_t bytes() const {
+            std::size_t total = 0;
+            for (const auto &level : levels)
+                total += level.size();
+            return total;
+        }
+    };
+
+    // true when the driver takes S3TC blocks; needs the GL context
+    inline bool supportsS3tc() {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+            if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+                return true;
+        }
+        return false;
+    }
+
+    // 2x2 box filter, an odd last row or column is averaged with itself
+    inline std::vector<unsigned char> halveRgba(const std::vector<unsigned char> &src, int width, int height) {
+        int w = std::max(width / 2, 1), h = std::max(height / 2, 1);
+        std::vector<unsigned char> dst((std::size_t)w * h * 4);
+        for (int y = 0; y < h; y++) {
+            int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            for (int x = 0; x < w; x++) {
+                int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                for (int c = 0; c < 4; c++) {
+                    int sum = src[((std::size_t)y0 * width + x0) * 4 + c] + src[((std::size_t)y0 * width + x1) * 4 + c] +
+                              src[((std::size_t)y1 * width + x0) * 4 + c] + src[((std::size_t)y1 * width + x1) * 4 + c];
+                    dst[((std::size_t)y * w + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        return dst;
+    }
+
+    inline std::uint16_t packRgb565(const int rgb[3]) {
+        return (std::uint16_t)((rgb[0] * 31 + 127) / 255 << 11 | (rgb[1] * 63 + 127) / 255 << 5 | (rgb[2] * 31 + 127) / 255);
+    }
+
+    inline void unpackRgb565(std::uint16_t color, int rgb[3]) {
+        int r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+        rgb[0] = r << 3 | r >> 2;
+        rgb[1] = g << 2 | g >> 4;
+        rgb[2] = b << 3 | b >> 2;
+    }
+
+    // Colour endpoints from the bounding box of the block, inset by 1/16 so the extremes do not dominate, then every
+    // texel takes the nearest of the four palette colours. Far from an exhaustive search, but fast enough to run at load.
+    inline void encodeColorBlock(const unsigned char block[64], unsigned char out[8]) {
+        int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 3; c++) {
+                lo[c] = std::min(lo[c], (int)block[i * 4 + c]);
+                hi[c] = std::max(hi[c], (int)block[i * 4 + c]);
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            int inset = (hi[c] - lo[c]) / 16;
+            lo[c] += inset;
+            hi[c] -= inset;
+        }
+        std::uint16_t c0 = packRgb565(hi), c1 = packRgb565(lo);
+        std::uint32_t indices = 0;
+        if (c0 < c1)
+            std::swap(c0, c1);
+        if (c0 != c1) {
+            // c0 > c1 selects the four colour mode
+            int palette[4][3];
+            unpackRgb565(c0, palette[0]);
+            unpackRgb565(c1, palette[1]);
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            for (int i = 0; i < 16; i++) {
+                int best = 0, bestDistance = 1 << 30;
+                for (int p = 0; p < 4; p++) {
+                    int distance = 0;
+                    for (int c = 0; c < 3; c++) {
+                        int d = block[i * 4 + c] - palette[p][c];
+                        distance += d * d;
+                    }
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+                indices |= (std::uint32_t)best << (i * 2);
+            }
+        }
+        out[0] = c0 & 255;
+        out[1] = c0 >> 8;
+        out[2] = c1 & 255;
+        out[3] = c1 >> 8;
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = indices >> (i * 8) & 255;
+    }
+
+    // alpha endpoints at the block's extremes, the eight value mode, 3 bit indices
+    inline void encodeAlphaBlock(const unsigned char block[64], unsigned char out[8]) {
+        int lo = 255, hi = 0;
+        for (int i = 0; i < 16; i++) {
+            lo = std::min(lo, (int)block[i * 4 + 3]);
+            hi = std::max(hi, (int)block[i * 4 + 3]);
+        }
+        std::uint64_t indices = 0;
+        if (hi != lo) {
+            int palette[8] = {hi, lo};
+            for (int p = 1; p < 7; p++)
+                palette[p + 1] = ((7 - p) * hi + p * lo) / 7;
+            for (int i = 0; i < 16; i++) {
+                int best = 0, bestDistance = 256;
+                for (int p = 0; p < 8; p++) {
+                    int distance = std::abs(block[i * 4 + 3] - palette[p]);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+                indices |= (std::uint64_t)best << (i * 3);
+            }
+        }
+        out[0] = (unsigned char)hi;
+        out[1] = (unsigned char)lo;
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = indices >> (i * 8) & 255;
+    }
+
+    // one mip level of RGBA8 texels; blocks past the right or bottom edge repeat the last texel
+    inline std::vector<unsigned char> compressLevel(const std::vector<unsigned char> &rgba, int width, int height, bool alpha) {
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        int blockBytes = alpha ? 16 : 8;
+        std::vector<unsigned char> out((std::size_t)blocksX * blocksY * blockBytes);
+        unsigned char block[64];
+        for (int by = 0; by < blocksY; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                for (int i = 0; i < 16; i++) {
+                    int x = std::min(bx * 4 + i % 4, width - 1), y = std::min(by * 4 + i / 4, height - 1);
+                    std::memcpy(block + i * 4, &rgba[((std::size_t)y * width + x) * 4], 4);
+                }
+                unsigned char *dst = &out[((std::size_t)by * blocksX + bx) * blockBytes];
+                if (alpha) {
+                    encodeAlphaBlock(block, dst);
+                    dst += 8;
+                }
+                encodeColorBlock(block, dst);
+            }
+        }
+        return out;
+    }
+
+    // an image as stb_image decoded it, 1 to 4 components, as RGBA8; grey images end up in all three colour channels,
+    // so a shader reading .r still gets them
+    inline std::vector<unsigned char> expandRgba(const unsigned char *pixels, int width, int height, int components) {
+        std::vector<unsigned char> rgba((std::size_t)width * height * 4);
+        for (std::size_t i = 0; i < (std::size_t)width * height; i++) {
+            const unsigned char *texel = pixels + i * components;
+            rgba[i * 4 + 0] = texel[0];
+            rgba[i * 4 + 1] = components >= 3 ? texel[1] : texel[0];
+            rgba[i * 4 + 2] = components >= 3 ? texel[2] : texel[0];
+            rgba[i * 4 + 3] = components == 4 ? texel[3] : components == 2 ? texel[1] : 255;
+        }
+        return rgba;
+    }
+
+    // bilinear, texel centres line up and the edges are clamped; for the layers of a texture array, which all have
+    // to be the same size
+    inline std::vector<unsigned char> resizeRgba(const std::vector<unsigned char> &src, int width, int height, int newWidth, int newHeight) {
+        std::vector<unsigned char> dst((std::size_t)newWidth * newHeight * 4);
+        for (int y = 0; y < newHeight; y++) {
+            float sy = std::min(std::max(((float)y + 0.5f) * height / newHeight - 0.5f, 0.0f), (float)(height - 1));
+            int y0 = (int)sy, y1 = std::min(y0 + 1, height - 1);
+            float fy = sy - y0;
+            for (int x = 0; x < newWidth; x++) {
+                float sx = std::min(std::max(((float)x + 0.5f) * width / newWidth - 0.5f, 0.0f), (float)(width - 1));
+                int x0 = (int)sx, x1 = std::min(x0 + 1, width - 1);
+                float fx = sx - x0;
+                for (int c = 0; c < 4; c++) {
+                    float top = src[((std::size_t)y0 * width + x0) * 4 + c] * (1.0f - fx) + src[((std::size_t)y0 * width + x1) * 4 + c] * fx;
+                    float bottom = src[((std::size_t)y1 * width + x0) * 4 + c] * (1.0f - fx) + src[((std::size_t)y1 * width + x1) * 4 + c] * fx;
+                    dst[((std::size_t)y * newWidth + x) * 4 + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+                }
+            }
+        }
+        return dst;
+    }
+
+    // RGBA8 texels down to the 1x1 mip, the alpha channel is dropped unless alpha is set
+    inline CompressedImage compressRgba(std::vector<unsigned char> rgba, int width, int height, bool alpha) {
+        CompressedImage image;
+        image.format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        image.width = width;
+        image.height = height;
+        int w = width, h = height;
+        while (true) {
+            image.levels.push_back(compressLevel(rgba, w, h, alpha));
+            if (w == 1 && h == 1)
+                break;
+            rgba = halveRgba(rgba, w, h);
+            w = std::max(w / 2, 1);
+            h = std::max(h / 2, 1);
+        }
+        return image;
+    }
+
+    inline CompressedImage compressImage(const unsigned char *pixels, int width, int height, int components) {
+        return compressRgba(expandRgba(pixels, width, height, components), width, height, components == 2 || components == 4);
+    }
+
+    // size and modification time of a source image, tells when it changed; 0 when the file is missing
+    inline std::uint64_t textureSourceStamp(const std::string &path) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return 0;
+        std::int64_t header[3] = {(std::int64_t)TEXTURE_CACHE_VERSION, (std::int64_t)info.st_size, (std::int64_t)info.st_mtime};
+        return hashBytes(header, sizeof(header));
+    }
+
+    // the source path and its stamp; 0 when the file is missing
+    inline std::uint64_t textureCacheKey(const std::string &path) {
+        std::uint64_t stamp = textureSourceStamp(path);
+        return stamp ? hashBytes(path.data(), path.size(), stamp) : 0;
+    }
+
+    inline std::string textureCachePath(const std::string &cacheDir, std::uint64_t key) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "texture_%016llx.bin", (unsigned long long)key);
+        return cacheDir + "/" + name;
+    }
+
+    // cache file: header, then the byte count and blocks of every level; anything that does not match key is ignored
+    struct TextureFileHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t format;
+        std::int32_t width, height;
+        std::uint32_t levelCount;
+    };
+
+    inline bool loadCompressedTexture(const std::string &path, std::uint64_t key, CompressedImage &image) {
+        std::ifstream file(path, std::ios::binary);
+        TextureFileHeader header;
+        if (!file.read((char *)&header, sizeof(header)))
+            return false;
+        if (std::memcmp(header.magic, "RGTX", 4) != 0 || header.version != TEXTURE_CACHE_VERSION || header.key != key ||
+            header.levelCount > 32)
+            return false;
+        image.format = header.format;
+        image.width = header.width;
+        image.height = header.height;
+        image.levels.resize(header.levelCount);
+        for (auto &level : image.levels) {
+            std::uint64_t size = 0;
+            if (!file.read((char *)&size, sizeof(size)) || size > ((std::uint64_t)1 << 30)) {
+                image = CompressedImage();
+                return false;
+            }
+            level.resize(size);
+            if (!file.read((char *)level.data(), size)) {
+                image = CompressedImage();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline bool saveCompressedTexture(const std::string &path, std::uint64_t key, const CompressedImage &image) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        TextureFileHeader header = {{'R', 'G', 'T', 'X'}, TEXTURE_CACHE_VERSION, key, image.format,
+                                    image.width, image.height, (std::uint32_t)image.levels.size()};
+        file.write((const char *)&header, sizeof(header));
+        for (const auto &level : image.levels) {
+            std::uint64_t size = level.size();
+            file.write((const char *)&size, sizeof(size));
+            file.write((const char *)level.data(), level.size());
+        }
+        if (!file) {
+            std::cout << "ERROR::TEXTURE_CACHE::WRITE_FAILED " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+};
+#endif //PROJECT_BASE_TEXTURECACHE_H
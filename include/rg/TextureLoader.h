@@ -0,0 +1,546 @@
+//
+// Created by bambino on 27.2.21..
+//
+
+#ifndef PROJECT_BASE_TEXTURELOADER_H
+#define PROJECT_BASE_TEXTURELOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <rg/TextureCache.h>
+#include <rg/TexturePack.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+    enum TextureWrap {
+        TEXTURE_REPEAT,
+        TEXTURE_CLAMP_IF_ALPHA  // images with an alpha channel are clamped so their transparent borders do not bleed
+    };
+
+    // Decodes images on worker threads and uploads them on the GL thread. Every load returns its texture at once,
+    // holding a 1x1 placeholder until update uploads the real image into the same texture object, so nothing that
+    // already uses the id has to change. With no workers the images are decoded and uploaded inside the load call.
+    // With a cache directory the workers compress each image once to S3TC with all its mips, see TextureCache.h,
+    // and later runs read the blocks instead of decoding. Images in a texture pack skip both, their blocks are
+    // uploaded straight from the pack's mapping.
+    class TextureLoader {
+    public:
+        explicit TextureLoader(unsigned int workerCount, bool usePixelBuffers = true, const std::string &cacheDir = "")
+        : usePixelBuffers(usePixelBuffers), cacheDir(cacheDir), start(std::chrono::steady_clock::now()) {
+            compressionSupported = supportsS3tc();
+            if (!this->cacheDir.empty() && !compressionSupported) {
+                std::cout << "ERROR::TEXTURE_LOADER::NO_S3TC uploading uncompressed textures" << std::endl;
+                this->cacheDir.clear();
+            }
+            for (unsigned int i = 0; i < workerCount; i++)
+                workers.emplace_back(&TextureLoader::workerLoop, this);
+        }
+
+        TextureLoader(const TextureLoader&) = delete;
+        TextureLoader& operator=(const TextureLoader&) = delete;
+
+        ~TextureLoader() {
+            shutdown();
+        }
+
+        // stops the workers, decodes still queued are dropped; frees the pixel buffer, needs the GL context
+        void shutdown() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                jobs.clear();
+            }
+            jobReady.notify_all();
+            for (std::thread &worker : workers)
+                worker.join();
+            workers.clear();
+            for (Image &image : finished)
+                stbi_image_free(image.pixels);
+            finished.clear();
+            for (auto &cube : cubeFaces) {
+                for (Image &image : cube.second)
+                    stbi_image_free(image.pixels);
+            }
+            cubeFaces.clear();
+            arrayLayers.clear();
+            if (pixelBuffer)
+                glDeleteBuffers(1, &pixelBuffer);
+            pixelBuffer = 0;
+        }
+
+        unsigned int load2D(const std::string &path, TextureWrap wrap = TEXTURE_CLAMP_IF_ALPHA) {
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            submit(Image{texture, GL_TEXTURE_2D, wrap, path});
+            return texture;
+        }
+
+        // faces in the order +x, -x, +y, -y, +z, -z; the six are uploaded together so the cube map is never incomplete
+        unsigned int loadCubemap(const std::vector<std::string> &faces) {
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+            for (unsigned int i = 0; i < 6; i++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+            for (unsigned int i = 0; i < faces.size() && i < 6; i++)
+                submit(Image{texture, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, TEXTURE_REPEAT, faces[i]});
+            return texture;
+        }
+
+        // One GL_TEXTURE_2D_ARRAY with a layer per path, every layer resized to size x size, uploaded together once
+        // all of them are decoded. With the cache the layers are BC1 compressed and alpha is dropped, a layer is taken
+        // from the pack when it was packed at that size; without the cache the array is RGBA8.
+        unsigned int loadArray(const std::vector<std::string> &paths, int size) {
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+            std::vector<unsigned char> placeholder(paths.size() * 4);
+            for (std::size_t i = 0; i < placeholder.size(); i++)
+                placeholder[i] = PLACEHOLDER[i % 4];
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, (GLsizei)paths.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            for (unsigned int i = 0; i < paths.size(); i++) {
+                Image image{texture, GL_TEXTURE_2D_ARRAY, TEXTURE_REPEAT, paths[i]};
+                image.layer = i;
+                image.layerCount = paths.size();
+                image.layerSize = size;
+                submit(std::move(image));
+            }
+            return texture;
+        }
+
+        // images found in the pack are not decoded, set before the first load; the pack has to outlive the loader
+        void usePack(const TexturePack *pack) {
+            if (pack && !compressionSupported)
+                return;
+            this->pack = pack;
+        }
+
+        // GL thread: uploads the images decoded since the last call, at most maxUploads of them (0 for all);
+        // returns the number uploaded
+        unsigned int update(unsigned int maxUploads = 0) {
+            std::vector<Image> ready;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                size_t count = maxUploads ? std::min<size_t>(maxUploads, finished.size()) : finished.size();
+                ready.assign(finished.begin(), finished.begin() + count);
+                finished.erase(finished.begin(), finished.begin() + count);
+            }
+            for (Image &image : ready)
+                upload(image);
+            if (!ready.empty() && pendingCount() == 0)
+                report();
+            return ready.size();
+        }
+
+        // blocks until every image is uploaded
+        void finish() {
+            while (pendingCount() > 0) {
+                if (update() == 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        // images submitted but not uploaded yet
+        unsigned int pendingCount() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return submitted - uploaded;
+        }
+
+        // ms from the construction of the loader until the last image was uploaded
+        double completedMs() const {
+            return completed;
+        }
+
+        // GPU memory of the uploaded textures; uncompressed RGB is counted as RGBA8, what drivers store it in
+        std::size_t textureBytes() const {
+            return residentBytes;
+        }
+
+        // images uploaded as S3TC blocks
+        unsigned int compressedCount() const {
+            return compressedImages;
+        }
+
+    private:
+        static constexpr unsigned char PLACEHOLDER[4] = {128, 128, 128, 255};
+
+        struct Image {
+            unsigned int texture;
+            GLenum target;
+            TextureWrap wrap;
+            std::string path;
+            int width = 0, height = 0, components = 0;
+            unsigned char *pixels = nullptr;
+            CompressedImage compressed{};   // instead of pixels when the cache is on
+            const TexturePackEntry *packed = nullptr;
+            // texture array layers only, their pixels are RGBA8 at the layer size
+            unsigned int layer = 0, layerCount = 0;
+            int layerSize = 0;
+            std::vector<unsigned char> rgba{};
+
+            bool decoded() const {
+                return pixels || !compressed.empty() || packed || !rgba.empty();
+            }
+
+            // the S3TC format of the blocks, 0 for pixels
+            GLenum blockFormat() const {
+                return packed ? packed->format : compressed.format;
+            }
+        };
+
+        bool usePixelBuffers;
+        bool compressionSupported = false;
+        std::string cacheDir;
+        const TexturePack *pack = nullptr;
+        std::chrono::steady_clock::time_point start;
+        double completed = 0.0;
+        std::size_t residentBytes = 0;
+        unsigned int compressedImages = 0;
+        unsigned int pixelBuffer = 0;
+        std::unordered_map<unsigned int, std::vector<Image>> cubeFaces;     // decoded faces of incomplete cube maps
+        std::unordered_map<unsigned int, std::vector<Image>> arrayLayers;   // decoded layers of incomplete arrays
+
+        // shared with the workers, guarded by mutex
+        std::mutex mutex;
+        std::condition_variable jobReady;
+        std::deque<Image> jobs;
+        std::vector<Image> finished;
+        unsigned int submitted = 0;
+        unsigned int uploaded = 0;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+
+        void submit(Image image) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                submitted++;
+            }
+            if (workers.empty()) {
+                decode(image);
+                upload(image);
+                report();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(std::move(image));
+            }
+            jobReady.notify_one();
+        }
+
+        // stbi_load is safe to call from several threads as long as nobody changes its global flags meanwhile
+        void decode(Image &image) {
+            if (image.target == GL_TEXTURE_2D_ARRAY) {
+                decodeLayer(image);
+                return;
+            }
+            image.packed = pack ? pack->find(image.path) : nullptr;
+            if (image.packed) {
+                image.width = image.packed->width;
+                image.height = image.packed->height;
+                return;
+            }
+            std::uint64_t key = cacheDir.empty() ? 0 : textureCacheKey(image.path);
+            std::string cachePath = key ? textureCachePath(cacheDir, key) : "";
+            if (key && loadCompressedTexture(cachePath, key, image.compressed)) {
+                image.width = image.compressed.width;
+                image.height = image.compressed.height;
+                return;
+            }
+            image.pixels = stbi_load(image.path.c_str(), &image.width, &image.height, &image.components, 0);
+            if (!image.pixels) {
+                std::cout << "Texture failed to load at path: " << image.path << std::endl;
+                return;
+            }
+            if (key) {
+                image.compressed = compressImage(image.pixels, image.width, image.height, image.components);
+                saveCompressedTexture(cachePath, key, image.compressed);
+                stbi_image_free(image.pixels);
+                image.pixels = nullptr;
+            }
+        }
+
+        // the layers of an array have to match in size and format, so the cache key includes the layer size and a
+        // packed image only counts when it was packed at that size
+        void decodeLayer(Image &image) {
+            bool compress = !cacheDir.empty();
+            image.packed = compress && pack ? pack->find(image.path) : nullptr;
+            if (image.packed && (image.packed->width != image.layerSize || image.packed->height != image.layerSize ||
+                                 image.packed->format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT))
+                image.packed = nullptr;
+            image.width = image.height = image.layerSize;
+            if (image.packed)
+                return;
+            std::uint64_t key = compress ? textureCacheKey(image.path) : 0;
+            if (key)
+                key = hashBytes(&image.layerSize, sizeof(image.layerSize), key);
+            std::string cachePath = key ? textureCachePath(cacheDir, key) : "";
+            if (key && loadCompressedTexture(cachePath, key, image.compressed))
+                return;
+            int width, height, components;
+            unsigned char *pixels = stbi_load(image.path.c_str(), &width, &height, &components, 0);
+            if (!pixels) {
+                std::cout << "Texture failed to load at path: " << image.path << std::endl;
+                return;
+            }
+            std::vector<unsigned char> rgba = expandRgba(pixels, width, height, components);
+            stbi_image_free(pixels);
+            if (width != image.layerSize || height != image.layerSize)
+                rgba = resizeRgba(rgba, width, height, image.layerSize, image.layerSize);
+            if (key) {
+                image.compressed = compressRgba(std::move(rgba), image.layerSize, image.layerSize, false);
+                saveCompressedTexture(cachePath, key, image.compressed);
+            } else
+                image.rgba = std::move(rgba);
+        }
+
+        void workerLoop() {
+            while (true) {
+                Image image;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    jobReady.wait(lock, [&] { return stopping || !jobs.empty(); });
+                    if (stopping)
+                        return;
+                    image = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                decode(image);
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.push_back(std::move(image));
+            }
+        }
+
+        void upload(Image &image) {
+            if (image.target == GL_TEXTURE_2D)
+                upload2D(image);
+            else if (image.target == GL_TEXTURE_2D_ARRAY)
+                uploadLayer(image);
+            else
+                uploadFace(image);
+        }
+
+        void upload2D(Image &image) {
+            if (image.blockFormat()) {
+                glBindTexture(GL_TEXTURE_2D, image.texture);
+                blockTexImage(GL_TEXTURE_2D, image, false);
+                GLint wrap = image.wrap == TEXTURE_CLAMP_IF_ALPHA && image.blockFormat() == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                             ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glBindTexture(GL_TEXTURE_2D, 0);
+                image.compressed = CompressedImage();
+            } else if (image.pixels) {
+                GLenum format = pixelFormat(image.components);
+                glBindTexture(GL_TEXTURE_2D, image.texture);
+                texImage(GL_TEXTURE_2D, image, format);
+                glGenerateMipmap(GL_TEXTURE_2D);
+                GLint wrap = image.wrap == TEXTURE_CLAMP_IF_ALPHA && format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glBindTexture(GL_TEXTURE_2D, 0);
+                stbi_image_free(image.pixels);
+                residentBytes += (std::size_t)image.width * image.height * (image.components == 3 ? 4 : image.components) * 4 / 3;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            uploaded++;
+        }
+
+        // the face waits until its cube map has all six, a failed face is kept as a placeholder
+        void uploadFace(Image &image) {
+            std::vector<Image> &faces = cubeFaces[image.texture];
+            faces.push_back(std::move(image));
+            if (faces.size() < 6)
+                return;
+            glBindTexture(GL_TEXTURE_CUBE_MAP, faces[0].texture);
+            bool complete = true;
+            for (Image &face : faces) {
+                complete = complete && face.decoded() && face.width == faces[0].width && face.height == faces[0].height &&
+                           face.blockFormat() == faces[0].blockFormat();
+            }
+            for (Image &face : faces) {
+                // the skybox is sampled without mips, like before, so only the top level is uploaded
+                if (complete && face.blockFormat())
+                    blockTexImage(face.target, face, true);
+                else if (complete)
+                    texImage(face.target, face, GL_RGB);
+                if (complete && face.pixels)
+                    residentBytes += (std::size_t)face.width * face.height * 4;
+                stbi_image_free(face.pixels);
+            }
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+            cubeFaces.erase(faces[0].texture);
+            std::lock_guard<std::mutex> lock(mutex);
+            uploaded += 6;
+        }
+
+        // the layer waits until its array has all of them, like the cube faces; the array keeps its placeholder when
+        // one failed
+        void uploadLayer(Image &image) {
+            std::vector<Image> &layers = arrayLayers[image.texture];
+            unsigned int layerCount = image.layerCount;
+            layers.push_back(std::move(image));
+            if (layers.size() < layerCount)
+                return;
+            std::sort(layers.begin(), layers.end(), [](const Image &a, const Image &b) { return a.layer < b.layer; });
+            bool complete = true;
+            for (const Image &layer : layers)
+                complete = complete && layer.decoded() && layer.blockFormat() == layers[0].blockFormat();
+            unsigned int texture = layers[0].texture;
+            int size = layers[0].layerSize;
+            glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+            if (!complete) {
+                std::cout << "ERROR::TEXTURE_LOADER::ARRAY_INCOMPLETE " << layers[0].path << std::endl;
+            } else if (layers[0].blockFormat()) {
+                std::size_t levelCount = blockLevelCount(layers[0]);
+                for (const Image &layer : layers)
+                    levelCount = std::min(levelCount, blockLevelCount(layer));
+                std::vector<unsigned char> blocks;
+                for (std::size_t level = 0; level < levelCount; level++) {
+                    // the layers of a level are consecutive in memory
+                    blocks.clear();
+                    for (const Image &layer : layers) {
+                        const unsigned char *data;
+                        std::size_t bytes;
+                        blockLevel(layer, level, data, bytes);
+                        blocks.insert(blocks.end(), data, data + bytes);
+                    }
+                    const void *data = stagePixels(blocks.data(), blocks.size());
+                    glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, layers[0].blockFormat(), std::max(size >> level, 1),
+                                           std::max(size >> level, 1), (GLsizei)layerCount, 0, (GLsizei)blocks.size(), data);
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                    residentBytes += blocks.size();
+                }
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
+                compressedImages += layerCount;
+            } else {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, (GLsizei)layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                for (const Image &layer : layers) {
+                    const void *pixels = stagePixels(layer.rgba.data(), layer.rgba.size());
+                    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)layer.layer, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                }
+                glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+                residentBytes += (std::size_t)size * size * 4 * layerCount * 4 / 3;
+            }
+            if (complete)
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            arrayLayers.erase(texture);
+            std::lock_guard<std::mutex> lock(mutex);
+            uploaded += layerCount;
+        }
+
+        // Through a pixel buffer the driver can copy to the GPU after the glTexImage call returns. Returns what to pass
+        // as the data pointer, the offset 0 into the bound buffer or data itself; unbind the buffer after the call.
+        const void *stagePixels(const void *data, std::size_t bytes) {
+            if (!usePixelBuffers)
+                return data;
+            if (!pixelBuffer)
+                glGenBuffers(1, &pixelBuffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+            // fresh storage every time, the driver may still be reading the previous image
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+            void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (!mapped) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                return data;
+            }
+            std::memcpy(mapped, data, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            return nullptr;
+        }
+
+        // rows are tightly packed
+        void texImage(GLenum target, const Image &image, GLenum format) {
+            const void *pixels = stagePixels(image.pixels, (std::size_t)image.width * image.height * image.components);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            // the cube faces keep the RGB internal format loadCubemap always used
+            glTexImage2D(target, 0, format, image.width, image.height, 0, pixelFormat(image.components), GL_UNSIGNED_BYTE, pixels);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        // all mips or only the top level; packed blocks go to GL straight from the mapping, there is nothing to stage
+        void blockTexImage(GLenum target, const Image &image, bool topLevelOnly) {
+            std::size_t levelCount = blockLevelCount(image);
+            if (topLevelOnly)
+                levelCount = std::min<std::size_t>(levelCount, 1);
+            for (std::size_t level = 0; level < levelCount; level++) {
+                const unsigned char *blocks;
+                std::size_t bytes;
+                blockLevel(image, level, blocks, bytes);
+                const void *data = image.packed ? blocks : stagePixels(blocks, bytes);
+                glCompressedTexImage2D(target, (GLint)level, image.blockFormat(), std::max(image.width >> level, 1),
+                                       std::max(image.height >> level, 1), 0, (GLsizei)bytes, data);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                residentBytes += bytes;
+            }
+            // the texture is only complete when its max level matches the levels uploaded
+            if (target == GL_TEXTURE_2D)
+                glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
+            compressedImages++;
+        }
+
+        std::size_t blockLevelCount(const Image &image) const {
+            return image.packed ? image.packed->levelCount : image.compressed.levels.size();
+        }
+
+        // the blocks of one level, in the pack's mapping or in the image
+        void blockLevel(const Image &image, std::size_t level, const unsigned char *&data, std::size_t &bytes) const {
+            if (image.packed) {
+                data = pack->levelData(*image.packed, level);
+                bytes = pack->level(*image.packed, level).size;
+            } else {
+                data = image.compressed.levels[level].data();
+                bytes = image.compressed.levels[level].size();
+            }
+        }
+
+        static GLenum pixelFormat(int components) {
+            return components == 1 ? GL_RED : components == 2 ? GL_RG : components == 3 ? GL_RGB : GL_RGBA;
+        }
+
+        void report() {
+            if (pendingCount() > 0)
+                return;
+            completed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    constexpr unsigned char TextureLoader::PLACEHOLDER[4];
+
+};
+#endif //PROJECT_BASE_TEXTURELOADER_H
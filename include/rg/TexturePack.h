@@ -0,0 +1,240 @@
+//
+// Created by bambino on 1.3.21..
+//
+
+#ifndef PROJECT_BASE_TEXTUREPACK_H
+#define PROJECT_BASE_TEXTUREPACK_H
+
+#include <rg/MappedFile.h>
+#include <rg/TextureCache.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+    // bumped when the pack layout changes, an old pack is ignored until it is packed again
+    const std::uint32_t TEXTURE_PACK_VERSION = 1;
+    // level data starts on this boundary inside the pack
+    const std::uint64_t TEXTURE_PACK_ALIGNMENT = 256;
+
+    // Pack file: header, entries sorted by name, levels, names, then the level blocks. Everything is read in place
+    // from the mapping, the entries are plain old data and the offsets are from the start of the file.
+    struct TexturePackHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t entryCount;
+        std::uint32_t levelCount;
+        std::uint64_t namesOffset;
+        std::uint64_t fileSize;
+    };
+
+    struct TexturePackEntry {
+        std::uint32_t nameOffset;   // into the names, relative to the resource root like FileSystem::getPath takes it
+        std::uint32_t nameLength;
+        std::uint64_t sourceStamp;  // textureSourceStamp of the image it was packed from
+        std::uint32_t format;       // GL_COMPRESSED_*_S3TC_*
+        std::int32_t width, height;
+        std::uint32_t firstLevel;
+        std::uint32_t levelCount;
+        std::uint32_t padding;
+    };
+
+    struct TexturePackLevel {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    // one image for writeTexturePack
+    struct TexturePackSource {
+        std::string name;
+        std::uint64_t sourceStamp;
+        CompressedImage image;
+    };
+
+    inline bool writeTexturePack(const std::string &path, std::vector<TexturePackSource> sources) {
+        std::sort(sources.begin(), sources.end(), [](const TexturePackSource &a, const TexturePackSource &b) {
+            return a.name < b.name;
+        });
+        std::vector<TexturePackEntry> entries;
+        std::vector<TexturePackLevel> levels;
+        std::string names;
+        for (const TexturePackSource &source : sources) {
+            entries.push_back(TexturePackEntry{(std::uint32_t)names.size(), (std::uint32_t)source.name.size(), source.sourceStamp,
+                                               source.image.format, source.image.width, source.image.height,
+                                               (std::uint32_t)levels.size(), (std::uint32_t)source.image.levels.size(), 0});
+            names += source.name;
+            for (const auto &level : source.image.levels)
+                levels.push_back(TexturePackLevel{0, level.size()});
+        }
+        auto align = [](std::uint64_t offset) {
+            return (offset + TEXTURE_PACK_ALIGNMENT - 1) / TEXTURE_PACK_ALIGNMENT * TEXTURE_PACK_ALIGNMENT;
+        };
+        std::uint64_t namesOffset = sizeof(TexturePackHeader) + entries.size() * sizeof(TexturePackEntry) +
+                                    levels.size() * sizeof(TexturePackLevel);
+        std::uint64_t offset = align(namesOffset + names.size());
+        for (TexturePackLevel &level : levels) {
+            level.offset = offset;
+            offset = align(offset + level.size);
+        }
+        TexturePackHeader header = {{'R', 'G', 'P', 'K'}, TEXTURE_PACK_VERSION, (std::uint32_t)entries.size(),
+                                    (std::uint32_t)levels.size(), namesOffset, offset};
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write((const char *)&header, sizeof(header));
+        file.write((const char *)entries.data(), entries.size() * sizeof(TexturePackEntry));
+        file.write((const char *)levels.data(), levels.size() * sizeof(TexturePackLevel));
+        file.write(names.data(), names.size());
+        const char zeros[TEXTURE_PACK_ALIGNMENT] = {};
+        std::uint64_t written = namesOffset + names.size();
+        unsigned int next = 0;
+        for (const TexturePackSource &source : sources) {
+            for (const auto &level : source.image.levels) {
+                file.write(zeros, levels[next].offset - written);
+                file.write((const char *)level.data(), level.size());
+                written = levels[next].offset + level.size();
+                next++;
+            }
+        }
+        file.write(zeros, offset - written);
+        if (!file) {
+            std::cout << "ERROR::TEXTURE_PACK::WRITE_FAILED " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // A pack written by texture_packer, mapped read only. Lookups and level data point into the mapping, the
+    // texture loader uploads straight from it.
+    class TexturePack {
+    public:
+        TexturePack() = default;
+        TexturePack(const TexturePack&) = delete;
+        TexturePack& operator=(const TexturePack&) = delete;
+
+        // root is the directory the entry names are relative to, FileSystem::getPath(""); false when there is no
+        // valid pack at path
+        bool open(const std::string &path, const std::string &root) {
+            close();
+            if (!file.open(path))
+                return false;
+            data = file.data();
+            size = file.size();
+            if (size < sizeof(TexturePackHeader) || !valid()) {
+                std::cout << "ERROR::TEXTURE_PACK::INVALID " << path << std::endl;
+                close();
+                return false;
+            }
+            this->root = root;
+            if (!this->root.empty() && this->root.back() != '/')
+                this->root += '/';
+            return true;
+        }
+
+        void close() {
+            file.close();
+            data = nullptr;
+            size = 0;
+        }
+
+        bool isOpen() const {
+            return data != nullptr;
+        }
+
+        // the entry of a path as FileSystem::getPath built it; nullptr when it is not packed or its source changed
+        // since, the image is then loaded from the source instead. Thread safe, it only reads the mapping.
+        const TexturePackEntry *find(const std::string &path) const {
+            if (!data)
+                return nullptr;
+            const char *name = path.c_str();
+            std::size_t length = path.size();
+            if (path.compare(0, root.size(), root) == 0) {
+                name += root.size();
+                length -= root.size();
+            }
+            const TexturePackEntry *first = entries(), *last = entries() + header().entryCount;
+            const TexturePackEntry *entry = std::lower_bound(first, last, 0, [&](const TexturePackEntry &e, int) {
+                return compareName(e, name, length) < 0;
+            });
+            if (entry == last || compareName(*entry, name, length) != 0)
+                return nullptr;
+            if (entry->sourceStamp != textureSourceStamp(path))
+                return nullptr;
+            return entry;
+        }
+
+        const TexturePackLevel &level(const TexturePackEntry &entry, unsigned int index) const {
+            return levels()[entry.firstLevel + index];
+        }
+
+        const unsigned char *levelData(const TexturePackEntry &entry, unsigned int index) const {
+            return data + level(entry, index).offset;
+        }
+
+        unsigned int entryCount() const {
+            return data ? header().entryCount : 0;
+        }
+
+        std::size_t mappedBytes() const {
+            return size;
+        }
+
+    private:
+        MappedFile file;
+        const unsigned char *data = nullptr;
+        std::size_t size = 0;
+        std::string root;
+
+        const TexturePackHeader &header() const {
+            return *(const TexturePackHeader *)data;
+        }
+
+        const TexturePackEntry *entries() const {
+            return (const TexturePackEntry *)(data + sizeof(TexturePackHeader));
+        }
+
+        const TexturePackLevel *levels() const {
+            return (const TexturePackLevel *)(entries() + header().entryCount);
+        }
+
+        const char *names() const {
+            return (const char *)data + header().namesOffset;
+        }
+
+        int compareName(const TexturePackEntry &entry, const char *name, std::size_t length) const {
+            int order = std::memcmp(names() + entry.nameOffset, name, std::min<std::size_t>(entry.nameLength, length));
+            if (order != 0)
+                return order;
+            return entry.nameLength < length ? -1 : entry.nameLength > length ? 1 : 0;
+        }
+
+        // every offset stays inside the file, so a truncated or foreign file is never read past its end
+        bool valid() const {
+            const TexturePackHeader &h = header();
+            if (std::memcmp(h.magic, "RGPK", 4) != 0 || h.version != TEXTURE_PACK_VERSION || h.fileSize != size)
+                return false;
+            std::uint64_t tables = sizeof(TexturePackHeader) + (std::uint64_t)h.entryCount * sizeof(TexturePackEntry) +
+                                   (std::uint64_t)h.levelCount * sizeof(TexturePackLevel);
+            if (tables > size || h.namesOffset != tables)
+                return false;
+            for (unsigned int i = 0; i < h.entryCount; i++) {
+                const TexturePackEntry &entry = entries()[i];
+                if (h.namesOffset + entry.nameOffset + entry.nameLength > size ||
+                    (std::uint64_t)entry.firstLevel + entry.levelCount > h.levelCount)
+                    return false;
+            }
+            for (unsigned int i = 0; i < h.levelCount; i++) {
+                if (levels()[i].offset + levels()[i].size > size)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+};
+#endif //PROJECT_BASE_TEXTUREPACK_H
@@ -0,0 +1,64 @@
+//
+// Created by bambino on 20.2.21..
+//
+
+#ifndef PROJECT_BASE_UNIFORMBUFFER_H
+#define PROJECT_BASE_UNIFORMBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace rg {
+
+    // binding point of the uniform block shared by the shaders, see resources/shaders/frame_data.glsl
+    const unsigned int FRAME_DATA_BINDING = 0;
+
+    // std140 layout of the FrameData block, vec3s are padded to vec4
+    struct FrameData {
+        glm::mat4 projection;
+        glm::mat4 view;
+        glm::vec4 viewPos;     // xyz
+        glm::vec4 viewFront;   // xyz, camera front and spot light direction
+        glm::vec4 clusterParams; // tiles per pixel in x and y, depth slice scale and bias, see LightClusters
+        glm::vec4 lightGridWindow; // first cell x and z, width and height of the cells covered by LightGrid
+        glm::vec4 spotPosition;    // xyz, the spot light is held next to the camera
+        glm::mat4 spotShadowMatrix; // world to spot shadow map clip space, see ShadowMaps
+    };
+
+    static_assert(sizeof(FrameData) == 272, "FrameData does not match the std140 block");
+
+    // buffer bound to a uniform block binding point for its whole lifetime
+    class UniformBuffer {
+    public:
+        unsigned int ID = 0;
+
+        void create(std::size_t size, unsigned int binding, const void *data = nullptr, GLenum usage = GL_DYNAMIC_DRAW) {
+            this->size = size;
+            glGenBuffers(1, &ID);
+            glBindBuffer(GL_UNIFORM_BUFFER, ID);
+            glBufferData(GL_UNIFORM_BUFFER, size, data, usage);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+        }
+
+        // one write of the whole block
+        void update(const void *data) const {
+            glBindBuffer(GL_UNIFORM_BUFFER, ID);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        void release() {
+            if (ID)
+                glDeleteBuffers(1, &ID);
+            ID = 0;
+        }
+
+    private:
+        std::size_t size = 0;
+    };
+
+};
+#endif //PROJECT_BASE_UNIFORMBUFFER_H
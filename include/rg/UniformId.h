@@ -0,0 +1,74 @@
+//
+// Created by bambino on 19.2.21..
+//
+
+#ifndef PROJECT_BASE_UNIFORMID_H
+#define PROJECT_BASE_UNIFORMID_H
+
+#include <cstddef>
+
+namespace rg {
+
+    constexpr unsigned int FNV_OFFSET_BASIS = 2166136261u;
+    constexpr unsigned int FNV_PRIME = 16777619u;
+
+    // 32 bit FNV-1a, constexpr so names written as literals can be hashed by the compiler
+    constexpr unsigned int fnv1a(const char *text, unsigned int hash = FNV_OFFSET_BASIS) {
+        while (*text) {
+            hash ^= (unsigned char)*text++;
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    // continues the hash with the decimal digits of value, same result as hashing to_string(value)
+    inline unsigned int fnv1a(int value, unsigned int hash) {
+        char digits[12];
+        int count = 0;
+        unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+        do {
+            digits[count++] = (char)('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        if (value < 0)
+            digits[count++] = '-';
+        while (count > 0) {
+            hash ^= (unsigned char)digits[--count];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    // handle of a uniform name, looked up by Shader without touching the name again
+    struct UniformId {
+        unsigned int hash = 0;
+
+        constexpr UniformId() = default;
+        explicit constexpr UniformId(const char *name) : hash(fnv1a(name)) {}
+    };
+
+    // handle of array[index].member (or array[index] without a member), built without allocating the name
+    inline UniformId uniformAt(const char *array, int index, const char *member = nullptr) {
+        UniformId id;
+        id.hash = fnv1a("]", fnv1a(index, fnv1a("[", fnv1a(array))));
+        if (member)
+            id.hash = fnv1a(member, fnv1a(".", id.hash));
+        return id;
+    }
+
+    // handle of name followed by number, e.g. texture_diffuse1, built without allocating the name
+    inline UniformId uniformNumbered(const char *name, int number) {
+        UniformId id;
+        id.hash = fnv1a(number, fnv1a(name));
+        return id;
+    }
+
+    inline namespace literals {
+        // "viewPos"_uniform; bind it to a constexpr variable, as an argument it may be hashed on every call
+        constexpr UniformId operator "" _uniform(const char *name, std::size_t) {
+            return UniformId(name);
+        }
+    };
+
+};
+#endif //PROJECT_BASE_UNIFORMID_H
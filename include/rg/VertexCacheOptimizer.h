@@ -0,0 +1,247 @@
+//
+// Created by bambino on 3.3.21..
+//
+
+#ifndef PROJECT_BASE_VERTEXCACHEOPTIMIZER_H
+#define PROJECT_BASE_VERTEXCACHEOPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace rg {
+
+    // how Model reorders the triangles and vertices of a mesh at import, before the upload and the mesh cache write
+    enum MeshOptimization {
+        MESH_OPTIMIZE_NONE,         // in the order Assimp returns them
+        MESH_OPTIMIZE_CACHE,        // vertex cache order, then the vertices in the order they are first used
+        MESH_OPTIMIZE_OVERDRAW      // as MESH_OPTIMIZE_CACHE, with outward facing parts of the mesh drawn first
+    };
+
+    // post transform cache efficiency of an index buffer, simulated as a FIFO of cacheSize vertices
+    struct VertexCacheStats {
+        float acmr = 0.0f;  // average cache miss ratio, vertex shader runs per triangle: 3 at worst, 0.5 at best
+        float atvr = 0.0f;  // average transform to vertex ratio, vertex shader runs per vertex: 1 is ideal
+    };
+
+    inline VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, std::size_t vertexCount,
+                                               unsigned int cacheSize = 16) {
+        VertexCacheStats stats;
+        if (indices.empty())
+            return stats;
+        // a vertex is in the cache when it entered it less than cacheSize misses ago
+        std::vector<unsigned int> entered(vertexCount, 0);
+        unsigned int misses = 0, used = 0;
+        for (unsigned int index : indices) {
+            if (entered[index] == 0)
+                used++;
+            if (entered[index] == 0 || misses - entered[index] >= cacheSize) {
+                misses++;
+                entered[index] = misses;
+            }
+        }
+        stats.acmr = (float)misses / (float)(indices.size() / 3);
+        stats.atvr = (float)misses / (float)used;
+        return stats;
+    }
+
+    // Forsyth's linear speed vertex cache optimisation: triangles are emitted greedily by the score of their
+    // vertices, which favours vertices that are recently used and have few triangles left
+    const unsigned int FORSYTH_CACHE_SIZE = 32;
+
+    inline float forsythVertexScore(int cachePosition, unsigned int remaining) {
+        if (remaining == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            // the three vertices of the last triangle get a fixed score, so it does not matter which one it was
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+        }
+        // vertices with few triangles left are finished first, so they do not have to come back later
+        return score + 2.0f / std::sqrt((float)remaining);
+    }
+
+    inline void optimizeVertexCache(std::vector<unsigned int> &indices, std::size_t vertexCount) {
+        std::size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+        // the triangles still to be emitted around every vertex, remaining[v] of them from offsets[v]
+        std::vector<unsigned int> remaining(vertexCount, 0), offsets(vertexCount + 1, 0);
+        for (unsigned int index : indices)
+            remaining[index]++;
+        for (std::size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + remaining[v];
+        std::vector<unsigned int> adjacency(indices.size());
+        {
+            std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < indices.size(); i++)
+                adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+        }
+        std::vector<float> vertexScore(vertexCount);
+        for (std::size_t v = 0; v < vertexCount; v++)
+            vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+        auto triangleScore = [&](std::size_t t) {
+            return vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] + vertexScore[indices[3 * t + 2]];
+        };
+
+        std::vector<char> emitted(triangleCount, 0);
+        std::vector<unsigned int> result, cache, next;
+        result.reserve(indices.size());
+        cache.reserve(FORSYTH_CACHE_SIZE + 3);
+        next.reserve(FORSYTH_CACHE_SIZE + 3);
+        long best = 0;
+        float bestScore = triangleScore(0);
+        for (std::size_t t = 1; t < triangleCount; t++) {
+            if (triangleScore(t) > bestScore) {
+                best = (long)t;
+                bestScore = triangleScore(t);
+            }
+        }
+        // where to continue when no triangle around the cache is left, the next one in the input order
+        std::size_t cursor = 0;
+        while (result.size() < indices.size()) {
+            if (best < 0) {
+                while (emitted[cursor])
+                    cursor++;
+                best = (long)cursor;
+            }
+            emitted[best] = 1;
+            next.clear();
+            for (unsigned int corner = 0; corner < 3; corner++) {
+                unsigned int v = indices[3 * best + corner];
+                result.push_back(v);
+                // take the triangle out of the vertex's list
+                unsigned int *first = &adjacency[offsets[v]], *last = first + remaining[v];
+                *std::find(first, last, (unsigned int)best) = *(last - 1);
+                remaining[v]--;
+                if (std::find(next.begin(), next.end(), v) == next.end())
+                    next.push_back(v);
+            }
+            // then the rest of the cache behind them
+            std::size_t added = next.size();
+            for (unsigned int v : cache) {
+                if (std::find(next.begin(), next.begin() + added, v) == next.begin() + added)
+                    next.push_back(v);
+            }
+            // the vertices that fell out of the cache
+            for (std::size_t i = FORSYTH_CACHE_SIZE; i < next.size(); i++)
+                vertexScore[next[i]] = forsythVertexScore(-1, remaining[next[i]]);
+            next.resize(std::min<std::size_t>(next.size(), FORSYTH_CACHE_SIZE));
+            cache.swap(next);
+            for (std::size_t i = 0; i < cache.size(); i++)
+                vertexScore[cache[i]] = forsythVertexScore((int)i, remaining[cache[i]]);
+            // the next triangle is the best one around the cache
+            best = -1;
+            bestScore = -1.0f;
+            for (unsigned int v : cache) {
+                for (unsigned int i = offsets[v]; i < offsets[v] + remaining[v]; i++) {
+                    float score = triangleScore(adjacency[i]);
+                    if (score > bestScore) {
+                        best = adjacency[i];
+                        bestScore = score;
+                    }
+                }
+            }
+        }
+        indices.swap(result);
+    }
+
+    // Reorders the triangles, already in vertex cache order, so that the parts of the mesh facing away from its
+    // centre are drawn first; they tend to cover the rest, which then fails the depth test instead of being shaded.
+    // The mesh is cut into clusters where the cache order starts over (a triangle missing all three vertices),
+    // which are sorted by how far out they face. Kept only when the cache miss ratio grows by less than threshold.
+    template<typename Position>
+    void optimizeOverdraw(std::vector<unsigned int> &indices, std::size_t vertexCount, Position position, float threshold = 1.05f) {
+        std::size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2)
+            return;
+        struct Cluster {
+            std::size_t first, count;
+            glm::vec3 centroid, normal;
+            float area;
+            float sortKey;
+        };
+        std::vector<Cluster> clusters;
+        std::vector<unsigned int> entered(vertexCount, 0);
+        unsigned int misses = 0;
+        const unsigned int cacheSize = 16;
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (std::size_t t = 0; t < triangleCount; t++) {
+            unsigned int triangleMisses = 0;
+            for (unsigned int corner = 0; corner < 3; corner++) {
+                unsigned int index = indices[3 * t + corner];
+                if (entered[index] == 0 || misses - entered[index] >= cacheSize) {
+                    misses++;
+                    triangleMisses++;
+                    entered[index] = misses;
+                }
+            }
+            if (t == 0 || triangleMisses == 3)
+                clusters.push_back(Cluster{t, 0, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 0.0f});
+            glm::vec3 a = position(indices[3 * t]), b = position(indices[3 * t + 1]), c = position(indices[3 * t + 2]);
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float area = glm::length(normal);
+            Cluster &cluster = clusters.back();
+            cluster.count++;
+            cluster.normal += normal;
+            cluster.centroid += (a + b + c) * (area / 3.0f);
+            cluster.area += area;
+            meshCentroid += (a + b + c) * (area / 3.0f);
+            meshArea += area;
+        }
+        if (clusters.size() < 2 || meshArea <= 0.0f)
+            return;
+        meshCentroid = meshCentroid * (1.0f / meshArea);
+        for (Cluster &cluster : clusters) {
+            float length = glm::length(cluster.normal);
+            cluster.sortKey = cluster.area > 0.0f && length > 0.0f ?
+                              glm::dot(cluster.centroid * (1.0f / cluster.area) - meshCentroid, cluster.normal * (1.0f / length)) : 0.0f;
+        }
+        std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {
+            return a.sortKey > b.sortKey;
+        });
+
+        std::vector<unsigned int> sorted;
+        sorted.reserve(indices.size());
+        for (const Cluster &cluster : clusters)
+            sorted.insert(sorted.end(), indices.begin() + 3 * cluster.first, indices.begin() + 3 * (cluster.first + cluster.count));
+        if (analyzeVertexCache(sorted, vertexCount).acmr <= analyzeVertexCache(indices, vertexCount).acmr * threshold)
+            indices.swap(sorted);
+    }
+
+    // Puts the vertices in the order the indices first use them, so the vertex fetch walks the buffer forwards.
+    // Vertices no triangle uses are dropped. Permutes in place, only the remap table is allocated.
+    template<typename V>
+    void optimizeVertexFetch(std::vector<V> &vertices, std::vector<unsigned int> &indices) {
+        const unsigned int unused = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), unused);
+        unsigned int used = 0;
+        for (unsigned int &index : indices) {
+            if (remap[index] == unused)
+                remap[index] = used++;
+            index = remap[index];
+        }
+        unsigned int end = used;
+        for (unsigned int &destination : remap) {
+            if (destination == unused)
+                destination = end++;
+        }
+        // follow each cycle of the permutation, every swap puts one vertex in its final place
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            while (remap[i] != i) {
+                std::swap(vertices[i], vertices[remap[i]]);
+                std::swap(remap[i], remap[remap[i]]);
+            }
+        }
+        vertices.erase(vertices.begin() + used, vertices.end());
+    }
+
+};
+#endif //PROJECT_BASE_VERTEXCACHEOPTIMIZER_H
@@ -0,0 +1,84 @@
+//
+// Created by bambino on 3.3.21..
+//
+
+#ifndef PROJECT_BASE_VERTEXPACKING_H
+#define PROJECT_BASE_VERTEXPACKING_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace rg {
+
+    // the compact model vertex, 16 bytes instead of the 56 of the float Vertex, with the attributes model.vs reads;
+    // decoded there with PACKED_VERTICES, see resources/shaders/packed_vertex.glsl
+    struct PackedVertex {
+        std::uint16_t position[4];  // unorm in the box of the mesh (packedBounds), w only keeps the normal 4 byte aligned
+        std::int16_t normal[2];     // octahedral, snorm
+        std::uint16_t texCoords[2]; // half floats, so repeating coordinates past 1 survive
+    };
+
+    // round to nearest even; out of range values become infinity
+    inline std::uint16_t halfFromFloat(float value) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        std::uint32_t sign = (bits >> 16) & 0x8000u;
+        std::uint32_t magnitude = bits & 0x7fffffffu;
+        if (magnitude >= 0x47800000u)       // 65536 and up, infinity and NaN
+            return (std::uint16_t)(sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u));
+        if (magnitude < 0x38800000u) {      // below the smallest normal half, in steps of 2^-24
+            float f;
+            std::memcpy(&f, &magnitude, sizeof(f));
+            return (std::uint16_t)(sign | (std::uint32_t)std::nearbyint(f * 16777216.0f));
+        }
+        return (std::uint16_t)(sign | ((magnitude - 0x38000000u + 0xfffu + ((magnitude >> 13) & 1u)) >> 13));
+    }
+
+    inline std::uint16_t unorm16(float value) {
+        return (std::uint16_t)std::lround(glm::clamp(value, 0.0f, 1.0f) * 65535.0f);
+    }
+
+    inline std::int16_t snorm16(float value) {
+        return (std::int16_t)std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+    }
+
+    // a unit vector folded onto the octahedron and unwrapped into the square, a zero vector gives (0, 0)
+    inline void octEncode(glm::vec3 v, std::int16_t out[2]) {
+        float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        glm::vec2 p = length > 0.0f ? glm::vec2(v.x / length, v.y / length) : glm::vec2(0.0f);
+        if (v.z < 0.0f)
+            p = glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                          (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+        out[0] = snorm16(p.x);
+        out[1] = snorm16(p.y);
+    }
+
+    // The packed positions are relative to the bounding box of their mesh: xyz is its low corner and w its largest
+    // side, the shaders decode bounds.xyz + position * bounds.w (the meshBounds uniform). The error is at most
+    // half of w / 65535 wherever the mesh sits, unlike half floats, whose steps grow with the distance from the origin.
+    inline glm::vec4 packedBounds(const glm::vec3 &low, const glm::vec3 &high) {
+        glm::vec3 size = high - low;
+        float scale = std::max(std::max(size.x, size.y), size.z);
+        return glm::vec4(low, scale > 0.0f ? scale : 1.0f);
+    }
+
+    inline PackedVertex packVertex(const glm::vec3 &position, const glm::vec3 &normal, const glm::vec2 &texCoords,
+                                   const glm::vec4 &bounds) {
+        PackedVertex packed;
+        glm::vec3 relative = (position - glm::vec3(bounds)) * (1.0f / bounds.w);
+        packed.position[0] = unorm16(relative.x);
+        packed.position[1] = unorm16(relative.y);
+        packed.position[2] = unorm16(relative.z);
+        packed.position[3] = 0;
+        octEncode(normal, packed.normal);
+        packed.texCoords[0] = halfFromFloat(texCoords.x);
+        packed.texCoords[1] = halfFromFloat(texCoords.y);
+        return packed;
+    }
+
+};
+#endif //PROJECT_BASE_VERTEXPACKING_H
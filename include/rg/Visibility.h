@@ -0,0 +1,149 @@
+//
+// Created by bambino on 18.2.21..
+//
+
+#ifndef PROJECT_BASE_VISIBILITY_H
+#define PROJECT_BASE_VISIBILITY_H
+
+#include <glm/glm.hpp>
+
+#include <rg/Maze.h>
+#include <rg/MazeMesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace rg {
+
+    // Cells that can be seen from the camera, found by casting 2D rays through the grid over the
+    // horizontal field of view. A ray stops at the first wall cell it enters, so from inside a
+    // corridor only the corridor and the walls around it are kept.
+    class GridVisibility {
+    public:
+        // square of cells around the camera the result covers, everything outside of it is hidden
+        MazeRect window{0, 0, 0, 0};
+
+        // returns false when occlusion does not apply (camera above the walls), everything counts as visible then
+        bool compute(const Maze &maze, const glm::vec3 &position, const glm::vec3 &front, float horizontalFov, float maxDistance) {
+            enabled = position.y < MAZE_FLOOR_Y + MAZE_WALL_HEIGHT;
+            cells.clear();
+            if (!enabled)
+                return false;
+
+            float ox = position.x + 0.5f;
+            float oz = position.z + 0.5f;
+            int reach = (int)std::ceil(maxDistance) + 1;
+            window = MazeRect{std::max(0, (int)std::floor(ox) - reach), std::max(0, (int)std::floor(oz) - reach),
+                              std::min(maze.width, (int)std::floor(ox) + reach + 1), std::min(maze.height, (int)std::floor(oz) + reach + 1)};
+            if (window.x1 <= window.x0 || window.z1 <= window.z0) {
+                mask.clear();
+                return true;
+            }
+            mask.assign(window.width() * window.height(), 0);
+
+            // one ray per cell of arc at maxDistance, so no corridor at the far end slips between two rays
+            float yaw = std::atan2(front.z, front.x);
+            float halfAngle = std::min(horizontalFov * 0.5f + 0.2f, 3.14159265f);
+            int rays = std::max(16, (int)std::ceil(2.0f * halfAngle * maxDistance));
+            for (int i = 0; i <= rays; i++) {
+                float angle = yaw - halfAngle + 2.0f * halfAngle * i / rays;
+                castRay(maze, ox, oz, std::cos(angle), std::sin(angle), maxDistance);
+            }
+
+            // walls touching a visible open cell show at least one face to the camera
+            unsigned int openCount = cells.size();
+            for (unsigned int i = 0; i < openCount; i++) {
+                int x = cells[i] % maze.width;
+                int z = cells[i] / maze.width;
+                if (maze.isWall(x, z))
+                    continue;
+                mark(maze, x + 1, z);
+                mark(maze, x - 1, z);
+                mark(maze, x, z + 1);
+                mark(maze, x, z - 1);
+            }
+            return true;
+        }
+
+        bool isEnabled() const {
+            return enabled;
+        }
+
+        bool isVisible(int x, int z) const {
+            if (!enabled)
+                return true;
+            if (!window.contains(x, z))
+                return false;
+            return mask[(z - window.z0) * window.width() + x - window.x0] != 0;
+        }
+
+        // true if any cell of rect is visible
+        bool anyVisible(const MazeRect &rect) const {
+            if (!enabled)
+                return true;
+            MazeRect clip{std::max(rect.x0, window.x0), std::max(rect.z0, window.z0), std::min(rect.x1, window.x1), std::min(rect.z1, window.z1)};
+            for (int z = clip.z0; z < clip.z1; z++) {
+                for (int x = clip.x0; x < clip.x1; x++) {
+                    if (mask[(z - window.z0) * window.width() + x - window.x0])
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        unsigned int visibleCount() const {
+            return cells.size();
+        }
+
+    private:
+        bool enabled = false;
+        std::vector<unsigned char> mask;
+        std::vector<int> cells;     // z * maze.width + x of every visible cell
+
+        void mark(const Maze &maze, int x, int z) {
+            if (!window.contains(x, z))
+                return;
+            unsigned char &m = mask[(z - window.z0) * window.width() + x - window.x0];
+            if (m)
+                return;
+            m = 1;
+            cells.push_back(z * maze.width + x);
+        }
+
+        // Amanatides/Woo grid traversal in cell units, cell (x, z) covers [x, x + 1) x [z, z + 1) after the +0.5 shift
+        void castRay(const Maze &maze, float ox, float oz, float dx, float dz, float maxDistance) {
+            const float inf = std::numeric_limits<float>::infinity();
+            int x = (int)std::floor(ox);
+            int z = (int)std::floor(oz);
+            int stepX = dx > 0.0f ? 1 : -1;
+            int stepZ = dz > 0.0f ? 1 : -1;
+            float tDeltaX = dx != 0.0f ? std::abs(1.0f / dx) : inf;
+            float tDeltaZ = dz != 0.0f ? std::abs(1.0f / dz) : inf;
+            float tMaxX = dx != 0.0f ? (dx > 0.0f ? x + 1 - ox : ox - x) * tDeltaX : inf;
+            float tMaxZ = dz != 0.0f ? (dz > 0.0f ? z + 1 - oz : oz - z) * tDeltaZ : inf;
+
+            // the camera is not clipped against the walls, so the cell it stands in never blocks
+            bool first = true;
+            float t = 0.0f;
+            while (t <= maxDistance) {
+                mark(maze, x, z);
+                if (!first && maze.isWall(x, z))
+                    return;
+                first = false;
+                if (tMaxX < tMaxZ) {
+                    t = tMaxX;
+                    tMaxX += tDeltaX;
+                    x += stepX;
+                } else {
+                    t = tMaxZ;
+                    tMaxZ += tDeltaZ;
+                    z += stepZ;
+                }
+            }
+        }
+    };
+
+};
+#endif //PROJECT_BASE_VISIBILITY_H
@@ -0,0 +1,38 @@
+#version 330 core
+// deferred lighting, full screen: the camera spot light, the baked lantern light with LIGHTMAP, and the colour
+// of the unlit lanterns
+out vec4 FragColor;
+
+#include "frame_data.glsl"
+#include "lights.glsl"
+#include "lighting.glsl"
+#include "gbuffer.glsl"
+#ifdef LIGHTMAP
+#include "lightmap.glsl"
+#endif
+#ifdef SHADOWS
+#include "shadows.glsl"
+#endif
+
+uniform SpotLight spotLight[MATERIAL_COUNT];
+
+void main()
+{
+    Surface surface;
+    int material;
+    if (!readSurface(surface, material))
+        discard;    // sky, drawn after lighting
+    if (material == MATERIAL_UNLIT) {
+        FragColor = vec4(surface.diffuse, 1.0);
+        return;
+    }
+    vec3 viewDir = normalize(viewPos.xyz - surface.position);
+    vec3 result = CalcSpotLight(spotLight[material], surface, viewDir);
+#ifdef SHADOWS
+    result *= spotShadowFactor(surface.position, surface.normal);
+#endif
+#ifdef LIGHTMAP
+    result += sampleLightmap(surface.position, surface.normal) * surface.diffuse;
+#endif
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+// depth prepass and overdraw view of the maze, reads only the position stream of rg::MazeMesh
+layout (location = 0) in vec3 aPos;
+
+// computed exactly like maze.vs, so their fragments pass the GL_EQUAL depth test
+invariant gl_Position;
+
+uniform mat4 model;
+#include "frame_data.glsl"
+
+void main()
+{
+    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
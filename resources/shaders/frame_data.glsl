@@ -0,0 +1,11 @@
+// camera data written once per frame, rg::FrameData on the C++ side (binding point 0)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;   // xyz
+    vec4 viewFront; // xyz, camera front and spot light direction
+    vec4 clusterParams; // tiles per pixel in x and y, depth slice scale and bias
+    vec4 lightGridWindow; // first cell x and z, width and height of the per cell light lists
+    vec4 spotPosition; // xyz, the spot light is held next to the camera
+    mat4 spotShadowMatrix; // world to spot shadow map clip space
+};
@@ -0,0 +1,30 @@
+#version 330 core
+// geometry pass of the deferred renderer, lit later from the G-buffer (see gbuffer.glsl)
+layout (location = 0) out vec4 normalOut;      // world normal, material id
+layout (location = 1) out vec4 albedoOut;
+layout (location = 2) out vec4 specularOut;
+
+in vec3 Normal;
+#ifdef UNLIT
+in vec2 TexCoord;
+uniform sampler2D texture_diffuse1;
+uniform int materialId;
+#else
+in vec3 FragPos;
+in vec2 TexCoords;
+flat in uvec3 Material;    // diffuse layer, specular layer, material id, see maze.vs
+uniform sampler2DArray mazeTextures;
+#endif
+
+void main()
+{
+#ifdef UNLIT
+    normalOut = vec4(normalize(Normal), float(materialId));
+    albedoOut = texture(texture_diffuse1, TexCoord);
+    specularOut = vec4(0.0);
+#else
+    normalOut = vec4(normalize(Normal), float(Material.z));
+    albedoOut = texture(mazeTextures, vec3(TexCoords, float(Material.x)));
+    specularOut = texture(mazeTextures, vec3(TexCoords, float(Material.y)));
+#endif
+}
@@ -0,0 +1,25 @@
+// G-buffer of the deferred renderer, written by gbuffer.fs and read by the lighting passes, see rg::GBuffer.
+// Needs frame_data.glsl and lighting.glsl.
+#include "materials.glsl"
+
+uniform sampler2D gNormal;      // world normal, material id
+uniform sampler2D gAlbedo;      // diffuse colour
+uniform sampler2D gSpecular;    // specular colour
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+uniform float materialShininess[MATERIAL_COUNT];
+
+// the surface under this fragment, false where nothing was drawn
+bool readSurface(out Surface surface, out int material)
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    vec4 normalMaterial = texelFetch(gNormal, pixel, 0);
+    material = int(normalMaterial.w + 0.5);
+    // world position back from the window depth
+    vec4 ndc = vec4(gl_FragCoord.xy / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 position = inverseViewProjection * ndc;
+    surface = Surface(position.xyz / position.w, normalMaterial.xyz, texelFetch(gAlbedo, pixel, 0).rgb,
+                      texelFetch(gSpecular, pixel, 0).rgb, materialShininess[clamp(material, 0, MATERIAL_COUNT - 1)]);
+    return depth < 1.0;
+}
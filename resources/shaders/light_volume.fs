@@ -0,0 +1,39 @@
+#version 330 core
+// deferred lighting, the pixels covered by one lantern's sphere, added to the spot light pass
+out vec4 FragColor;
+
+flat in int lightIndex;
+
+#include "frame_data.glsl"
+#include "lights.glsl"
+#include "lighting.glsl"
+#include "gbuffer.glsl"
+#ifdef SHADOWS
+#include "shadows.glsl"
+#endif
+
+uniform PointLightColor pointLightColor[MATERIAL_COUNT];
+
+void main()
+{
+    Surface surface;
+    int material;
+    if (!readSurface(surface, material) || material == MATERIAL_UNLIT)
+        discard;
+#ifndef LIGHTS_CLUSTERED
+    // walls block the lantern the same way as in the forward shaders
+    uvec2 lights = cellLights(surface.position, surface.normal);
+    bool reached = false;
+    for (uint i = 0u; i < lights.y && !reached; i++)
+        reached = int(texelFetch(cellLightIndices, int(lights.x + i)).r) == lightIndex;
+    if (!reached)
+        discard;
+#endif
+    vec3 viewDir = normalize(viewPos.xyz - surface.position);
+    PointLight light = fetchLight(lightIndex);
+    vec3 color = CalcPointLight(light, pointLightColor[material], surface, viewDir);
+#ifdef SHADOWS
+    color *= lanternShadow(lightIndex, light, surface.position, surface.normal);
+#endif
+    FragColor = vec4(color, 1.0);
+}
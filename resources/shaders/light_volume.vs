@@ -0,0 +1,17 @@
+#version 330 core
+// deferred lighting, one instance of a sphere around every lantern near the camera
+layout (location = 0) in vec3 aPos;     // unit sphere
+layout (location = 1) in uint aLight;   // per instance, index into lightData
+
+flat out int lightIndex;
+
+#include "frame_data.glsl"
+// lights.glsl reads gl_FragCoord, so only the light buffer is declared here
+uniform samplerBuffer lightData;        // per light: position and radius, attenuation
+
+void main()
+{
+    lightIndex = int(aLight);
+    vec4 positionRadius = texelFetch(lightData, 2 * lightIndex);
+    gl_Position = projection * view * vec4(positionRadius.xyz + aPos * positionRadius.w, 1.0);
+}
@@ -0,0 +1,78 @@
+// Phong lighting shared by the forward maze shaders and the deferred lighting passes, needs frame_data.glsl and lights.glsl
+
+// colours are per material, the same for every lantern
+struct PointLightColor {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// position and direction come from FrameData
+struct SpotLight {
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// what the lights need to know about a fragment, the textures are sampled once instead of once per light
+struct Surface {
+    vec3 position;
+    vec3 normal;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, PointLightColor color, Surface surface, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - surface.position);
+    // diffuse shading
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+    // attenuation
+    float distance = length(light.position - surface.position);
+    float attenuation = lightWindow(distance, light.radius) / (light.attenuation.x + light.attenuation.y * distance + light.attenuation.z * (distance * distance));
+    // combine results
+    vec3 ambient = color.ambient * surface.diffuse;
+    vec3 diffuse = color.diffuse * diff * surface.diffuse;
+    vec3 specular = color.specular * spec * surface.specular;
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+// calculates the color when using a spot light.
+vec3 CalcSpotLight(SpotLight light, Surface surface, vec3 viewDir)
+{
+    vec3 lightDir = normalize(spotPosition.xyz - surface.position);
+
+    // diffuse shading
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+
+    // attenuation
+    float distance = length(spotPosition.xyz - surface.position);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    // spotlight intensity
+    float theta = dot(lightDir, normalize(-viewFront.xyz));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+    // combine results
+    vec3 ambient = light.ambient * surface.diffuse;
+    vec3 diffuse = light.diffuse * diff * surface.diffuse;
+    vec3 specular = light.specular * spec * surface.specular;
+    return (ambient + diffuse + specular) * attenuation * intensity;
+}
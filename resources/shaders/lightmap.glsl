@@ -0,0 +1,65 @@
+// lantern light baked by rg::bakeLightmap, ambient and diffuse only; keep the layout in sync with rg/Lightmap.h
+#define LIGHTMAP_TEXELS_PER_UNIT 2
+#define LIGHTMAP_RANGE 8.0
+#define LIGHTMAP_NO_PAGE 0xFFFFFFFFu
+#define MAZE_FLOOR_Y -0.5
+
+uniform usamplerBuffer lightmapPages;   // per cell of lightmapRect: first texel, wall faces present
+uniform samplerBuffer lightmapTexels;   // RGBM
+uniform vec4 lightmapRect;              // first cell x and z, width and height
+
+vec3 lightmapTexel(int index)
+{
+    vec4 rgbm = texelFetch(lightmapTexels, index);
+    return rgbm.rgb * rgbm.a * LIGHTMAP_RANGE;
+}
+
+// baked light at a maze surface point, the normal picks the cell in front of a wall face and the face itself
+vec3 sampleLightmap(vec3 position, vec3 normal)
+{
+    vec3 p = position + normal * 0.5;
+    ivec2 cell = ivec2(floor(p.xz + 0.5));
+    ivec2 local = cell - ivec2(lightmapRect.xy);
+    if (any(lessThan(local, ivec2(0))) || any(greaterThanEqual(local, ivec2(lightmapRect.zw))))
+        return vec3(0.0);
+    uint page = texelFetch(lightmapPages, local.y * int(lightmapRect.z) + local.x).r;
+    if (page == LIGHTMAP_NO_PAGE)
+        return vec3(0.0);
+
+    int first = int(page & 0x07FFFFFFu);
+    uint faces = page >> 27;
+    vec2 corner = vec2(cell) - 0.5;
+    vec2 uv;
+    int rows = LIGHTMAP_TEXELS_PER_UNIT;
+    if (normal.y > 0.5) {
+        uv = position.xz - corner;
+    } else {
+        // wall faces follow the up face in the order +x, -x, +z, -z of their normal, only the present ones
+        int face;
+        if (abs(normal.x) > 0.5) {
+            face = normal.x > 0.0 ? 0 : 1;
+            uv = vec2(position.z - corner.y, position.y - MAZE_FLOOR_Y);
+        } else {
+            face = normal.z > 0.0 ? 2 : 3;
+            uv = vec2(position.x - corner.x, position.y - MAZE_FLOOR_Y);
+        }
+        if ((faces & (1u << uint(face))) == 0u)
+            return vec3(0.0);
+        first += LIGHTMAP_TEXELS_PER_UNIT * LIGHTMAP_TEXELS_PER_UNIT;
+        for (int f = 0; f < face; f++) {
+            if ((faces & (1u << uint(f))) != 0u)
+                first += 2 * LIGHTMAP_TEXELS_PER_UNIT * LIGHTMAP_TEXELS_PER_UNIT;
+        }
+        rows = 2 * LIGHTMAP_TEXELS_PER_UNIT;
+    }
+
+    // bilinear between the four nearest texel centres, clamped to this face
+    ivec2 last = ivec2(LIGHTMAP_TEXELS_PER_UNIT - 1, rows - 1);
+    vec2 t = clamp(uv * float(LIGHTMAP_TEXELS_PER_UNIT) - 0.5, vec2(0.0), vec2(last));
+    ivec2 t0 = ivec2(floor(t));
+    ivec2 t1 = min(t0 + 1, last);
+    vec2 f = t - vec2(t0);
+    vec3 bottom = mix(lightmapTexel(first + t0.y * LIGHTMAP_TEXELS_PER_UNIT + t0.x), lightmapTexel(first + t0.y * LIGHTMAP_TEXELS_PER_UNIT + t1.x), f.x);
+    vec3 top = mix(lightmapTexel(first + t1.y * LIGHTMAP_TEXELS_PER_UNIT + t0.x), lightmapTexel(first + t1.y * LIGHTMAP_TEXELS_PER_UNIT + t1.x), f.x);
+    return mix(bottom, top, f.y);
+}
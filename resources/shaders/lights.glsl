@@ -0,0 +1,51 @@
+// lantern lights, listed per maze cell by rg::LightGrid or per cluster by rg::LightClusters, needs frame_data.glsl
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+
+uniform samplerBuffer lightData;        // per light: position and radius, attenuation
+uniform usamplerBuffer clusterGrid;     // per cluster: first entry in lightIndices, light count
+uniform usamplerBuffer lightIndices;
+uniform usamplerBuffer cellLightGrid;   // per cell of lightGridWindow: first entry in cellLightIndices, light count
+uniform usamplerBuffer cellLightIndices;
+
+struct PointLight {
+    vec3 position;
+    float radius;
+    vec3 attenuation;   // constant, linear, quadratic
+};
+
+PointLight fetchLight(int index)
+{
+    vec4 positionRadius = texelFetch(lightData, 2 * index);
+    vec4 attenuation = texelFetch(lightData, 2 * index + 1);
+    return PointLight(positionRadius.xyz, positionRadius.w, attenuation.xyz);
+}
+
+// lights of the cluster holding this fragment, viewDepth is the positive view space distance
+uvec2 clusterLights(float viewDepth)
+{
+    ivec2 tile = ivec2(gl_FragCoord.xy * clusterParams.xy);
+    int slice = int(log(viewDepth) * clusterParams.z + clusterParams.w);
+    tile = clamp(tile, ivec2(0), ivec2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1));
+    slice = clamp(slice, 0, CLUSTER_SLICES - 1);
+    return texelFetch(clusterGrid, (slice * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x).xy;
+}
+
+// lights that reach the maze cell of this fragment, the normal moves wall faces into the open cell in front of them
+uvec2 cellLights(vec3 fragPos, vec3 normal)
+{
+    vec3 p = fragPos + normal * 0.5;
+    ivec2 cell = ivec2(floor(p.xz + 0.5)) - ivec2(lightGridWindow.xy);
+    if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, ivec2(lightGridWindow.zw))))
+        return uvec2(0u);
+    return texelFetch(cellLightGrid, cell.y * int(lightGridWindow.z) + cell.x).xy;
+}
+
+// 1 at the light, 0 from radius on, so a light only has to be assigned to the clusters its sphere touches
+float lightWindow(float distance, float radius)
+{
+    float ratio = distance / radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window;
+}
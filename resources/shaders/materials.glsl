@@ -0,0 +1,5 @@
+// material ids of the maze and the lanterns, see rg::MazeMaterial
+#define MATERIAL_UNLIT 0    // lantern models, shown with their texture colour
+#define MATERIAL_WALL 1
+#define MATERIAL_FLOOR 2
+#define MATERIAL_COUNT 3
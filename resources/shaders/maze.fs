@@ -0,0 +1,88 @@
+#version 330 core
+// forward pass of the whole maze, walls and floor of every material in one draw
+out vec4 FragColor;
+
+#include "materials.glsl"
+#include "frame_data.glsl"
+#include "lights.glsl"
+#include "lighting.glsl"
+#ifdef LIGHTMAP
+#include "lightmap.glsl"
+#endif
+#ifdef SHADOWS
+#include "shadows.glsl"
+#endif
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+flat in uvec3 Material;
+
+// every maze texture, the layers come from the vertices
+uniform sampler2DArray mazeTextures;
+// lighting per material id, set like the deferred passes' arrays
+uniform PointLightColor pointLightColor[MATERIAL_COUNT];
+uniform SpotLight spotLight[MATERIAL_COUNT];
+uniform float materialShininess[MATERIAL_COUNT];
+#ifdef LIGHTS_UNCLUSTERED
+uniform int lightCount;     // every light is evaluated, for comparison in --bench lights
+#endif
+
+float near = 0.1;
+float far = 100.0;
+float LinearizeDepth(float depth) {
+    float z = depth * 2.0 - 1.0; // back to NDC
+    return (2.0 * near * far) / (far + near - z * (far - near));
+}
+
+
+// one lantern's light, less what the walls hold back
+vec3 lantern(int index, int material, Surface surface, vec3 viewDir)
+{
+    PointLight light = fetchLight(index);
+    vec3 color = CalcPointLight(light, pointLightColor[material], surface, viewDir);
+#ifdef SHADOWS
+    color *= lanternShadow(index, light, surface.position, surface.normal);
+#endif
+    return color;
+}
+
+void main()
+{
+    // properties
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
+    int material = int(Material.z);
+    Surface surface = Surface(FragPos, norm, vec3(texture(mazeTextures, vec3(TexCoords, float(Material.x)))),
+                              vec3(texture(mazeTextures, vec3(TexCoords, float(Material.y)))), materialShininess[material]);
+
+    vec3 result = vec3(0.0);
+    // phase 2: point lights, only the ones that reach this fragment's cell, or their baked ambient and diffuse light
+#if defined(LIGHTMAP)
+    result += sampleLightmap(FragPos, norm) * surface.diffuse;
+#elif defined(LIGHTS_UNCLUSTERED)
+    for(int i = 0; i < lightCount; i++)
+        result += lantern(i, material, surface, viewDir);
+#elif defined(LIGHTS_CLUSTERED)
+    uvec2 lights = clusterLights(LinearizeDepth(gl_FragCoord.z));
+    for(uint i = 0u; i < lights.y; i++)
+        result += lantern(int(texelFetch(lightIndices, int(lights.x + i)).r), material, surface, viewDir);
+#else
+    uvec2 lights = cellLights(FragPos, norm);
+    for(uint i = 0u; i < lights.y; i++)
+        result += lantern(int(texelFetch(cellLightIndices, int(lights.x + i)).r), material, surface, viewDir);
+#endif
+    // phase 3: spot light
+#ifdef SHADOWS
+    result += CalcSpotLight(spotLight[material], surface, viewDir) * spotShadowFactor(FragPos, norm);
+#else
+    result += CalcSpotLight(spotLight[material], surface, viewDir);
+#endif
+
+    float depth = LinearizeDepth(gl_FragCoord.z) / far;
+//    if(length(depth + FragPos) > 1)
+        FragColor = vec4(result, 1.0);
+//    else {
+//        FragColor = vec4(vec3(depth), 1.0);
+//    }
+}
@@ -0,0 +1,39 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in uvec4 aMaterial;   // diffuse layer, specular layer, material id, see rg::MazeMaterial
+
+out vec2 TexCoords;
+out vec3 FragPos;
+out vec3 Normal;
+flat out uvec3 Material;
+// the same position as depth_prepass.vs, the lit pass after the prepass tests depth with GL_EQUAL
+invariant gl_Position;
+
+uniform mat4 model;
+// normal transform variants, chosen when the program is built:
+// NORMALS_TRANSLATION_ONLY  model only moves the mesh, normals are used as they are
+// NORMALS_PER_VERTEX        inverse transpose of model computed for every vertex
+// neither                   inverse transpose of model precomputed by the renderer
+#if !defined(NORMALS_TRANSLATION_ONLY) && !defined(NORMALS_PER_VERTEX)
+uniform mat3 normalMatrix;
+#endif
+#include "frame_data.glsl"
+
+void main()
+{
+    FragPos = vec3(model * vec4(aPos, 1.0));
+#if defined(NORMALS_TRANSLATION_ONLY)
+    Normal = aNormal;
+#elif defined(NORMALS_PER_VERTEX)
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+#else
+    Normal = normalMatrix * aNormal;
+#endif
+	TexCoords = vec2(aTexCoord.x, aTexCoord.y);
+    Material = aMaterial.xyz;
+
+	gl_Position = projection * view * vec4(FragPos, 1.0f);
+
+}
\ No newline at end of file
@@ -1,15 +1,34 @@
 #version 330 core
+// Assimp models; with PACKED_VERTICES the mesh uses the 16 byte rg::PackedVertex instead of the float Vertex
+#ifdef PACKED_VERTICES
+layout (location = 0) in vec3 aPos;         // in the box of meshBounds
+layout (location = 1) in vec2 aNormal;      // octahedral
+layout (location = 2) in vec2 aTexCoord;
+#else
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+#endif
 
+out vec3 Normal;    // world space, written to the G-buffer by gbuffer.fs
 out vec2 TexCoord;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform vec4 meshBounds;    // set by Mesh::Draw
+#include "frame_data.glsl"
+#include "packed_vertex.glsl"
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0f);
-	TexCoord = vec2(aTexCoord.x, aTexCoord.y);
-}
\ No newline at end of file
+#ifdef PACKED_VERTICES
+	vec3 position = boundsDecode(aPos, meshBounds);
+	vec3 normal = octDecode(aNormal);
+#else
+	vec3 position = aPos;
+	vec3 normal = aNormal;
+#endif
+	// the models are only rotated and uniformly scaled, so model itself transforms their normals
+	Normal = normalize(mat3(model) * normal);
+	gl_Position = projection * view * model * vec4(position, 1.0f);
+	TexCoord = aTexCoord;
+}
@@ -0,0 +1,8 @@
+#version 330 core
+// overdraw view: every fragment that would be lit adds one step with additive blending, red after 8, white after 32
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(0.125, 0.0625, 0.03125, 1.0);
+}
@@ -0,0 +1,16 @@
+// decoding of rg::PackedVertex, the compact model vertex
+
+// the position in model space from the one in the box of the mesh, see rg::packedBounds
+vec3 boundsDecode(vec3 p, vec4 bounds)
+{
+    return bounds.xyz + p * bounds.w;
+}
+
+// inverse of rg::octEncode
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
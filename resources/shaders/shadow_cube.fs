@@ -0,0 +1,10 @@
+#version 330 core
+// the distance to the lantern over its radius instead of the projected depth, the same value for every cube face
+in vec3 WorldPos;
+
+uniform vec4 lightPositionRadius;
+
+void main()
+{
+    gl_FragDepth = length(WorldPos - lightPositionRadius.xyz) / lightPositionRadius.w;
+}
@@ -0,0 +1,14 @@
+#version 330 core
+// lantern shadow maps, one instance of a wall block for every wall cell around the lantern, see rg::ShadowMaps
+layout (location = 0) in vec3 aPos;     // block around x = z = 0, from the floor to the wall tops
+layout (location = 1) in vec2 aCell;    // per instance, x and z of the wall cell
+
+out vec3 WorldPos;
+
+uniform mat4 faceViewProjection;
+
+void main()
+{
+    WorldPos = vec3(aPos.x + aCell.x, aPos.y, aPos.z + aCell.y);
+    gl_Position = faceViewProjection * vec4(WorldPos, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+// spot light shadow map, walls and lanterns drawn from the spot light
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform vec4 meshBounds;    // packed lanterns are in the box of their mesh, (0, 0, 0, 1) for the walls
+#include "frame_data.glsl"
+#include "packed_vertex.glsl"
+
+void main()
+{
+    gl_Position = spotShadowMatrix * model * vec4(boundsDecode(aPos, meshBounds), 1.0);
+}
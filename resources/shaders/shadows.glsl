@@ -0,0 +1,55 @@
+// shadow maps of rg::ShadowMaps, 4 taps of hardware 2x2 PCF each; needs frame_data.glsl and lights.glsl
+#define LANTERN_SHADOW_SIZE 256.0
+#define SPOT_SHADOW_SIZE 1024.0
+
+uniform sampler2DArrayShadow lanternShadows;    // six layers per slot, distance to the lantern over its radius
+uniform isamplerBuffer lanternShadowSlots;      // per light: slot in lanternShadows, -1 when it casts no shadow
+uniform sampler2DShadow spotShadow;
+
+// forward and up of the cube faces, keep in sync with rg/ShadowMaps.h
+const vec3 SHADOW_FACE_FORWARD[6] = vec3[6](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
+const vec3 SHADOW_FACE_UP[6] = vec3[6](vec3(0, -1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, -1, 0), vec3(0, -1, 0));
+
+// 1 where the lantern reaches the surface point, 0 where a wall is in between
+float lanternShadow(int index, PointLight light, vec3 position, vec3 normal)
+{
+    int slot = texelFetch(lanternShadowSlots, index).r;
+    if (slot < 0)
+        return 1.0;
+    // pushed out along the normal by about a texel, which grows with the distance
+    vec3 d = position - light.position;
+    d += normal * (2.5 * length(d) / LANTERN_SHADOW_SIZE);
+    vec3 a = abs(d);
+    int face = a.x >= a.y && a.x >= a.z ? (d.x > 0.0 ? 0 : 1) : (a.y >= a.z ? (d.y > 0.0 ? 2 : 3) : (d.z > 0.0 ? 4 : 5));
+
+    // the projection of glm::lookAt and a 90 degree glm::perspective for this face
+    vec3 forward = SHADOW_FACE_FORWARD[face];
+    vec3 right = normalize(cross(forward, SHADOW_FACE_UP[face]));
+    vec3 up = cross(right, forward);
+    vec2 uv = vec2(dot(d, right), dot(d, up)) / dot(d, forward) * 0.5 + 0.5;
+    float reference = length(d) / light.radius;
+
+    // the taps stay on this face, the next one is another layer
+    float texel = 1.0 / LANTERN_SHADOW_SIZE;
+    float layer = float(slot * 6 + face);
+    float lit = 0.0;
+    for (int i = 0; i < 4; i++) {
+        vec2 tap = clamp(uv + vec2(i & 1, i >> 1) * texel - 0.5 * texel, vec2(0.5 * texel), vec2(1.0 - 0.5 * texel));
+        lit += texture(lanternShadows, vec4(tap, layer, reference));
+    }
+    return lit * 0.25;
+}
+
+// 1 where the camera spot light reaches the surface point, 0 in the shadow of a wall or lantern
+float spotShadowFactor(vec3 position, vec3 normal)
+{
+    vec4 p = spotShadowMatrix * vec4(position + normal * 0.02, 1.0);
+    vec3 coords = p.xyz / p.w * 0.5 + 0.5;
+    if (coords.z >= 1.0)
+        return 1.0;
+    float texel = 1.0 / SPOT_SHADOW_SIZE;
+    float lit = 0.0;
+    for (int i = 0; i < 4; i++)
+        lit += texture(spotShadow, vec3(coords.xy + (vec2(i & 1, i >> 1) - 0.5) * texel, coords.z));
+    return lit * 0.25;
+}
@@ -0,0 +1,29 @@
+#version 330 core
+out vec4 FragColor;
+
+// the point lights as plain uniforms, only used by --bench uniforms
+struct PointLight {
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+#define NR_POINT_LIGHTS 5
+
+uniform vec3 viewPos;
+uniform PointLight pointLights[NR_POINT_LIGHTS];
+
+void main()
+{
+    vec3 result = viewPos;
+    for(int i = 0; i < NR_POINT_LIGHTS; i++)
+        result += pointLights[i].position + pointLights[i].ambient + pointLights[i].diffuse + pointLights[i].specular
+                + vec3(pointLights[i].constant, pointLights[i].linear, pointLights[i].quadratic);
+    FragColor = vec4(result, 1.0);
+}
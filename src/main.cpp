@@ -9,17 +9,40 @@
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
-
+#include <rg/FrameStats.h>
+#include <rg/Maze.h>
+#include <rg/MazeMaterials.h>
+#include <rg/MazeWorld.h>
+#include <rg/Frustum.h>
+#include <rg/Visibility.h>
+#include <rg/Settings.h>
+#include <rg/UniformId.h>
+#include <rg/Benchmark.h>
+#include <rg/UniformBuffer.h>
+#include <rg/GpuTimer.h>
+#include <rg/NormalMatrix.h>
+#include <rg/ClusteredLights.h>
+#include <rg/LightGrid.h>
+#include <rg/SurfaceLighting.h>
+#include <rg/DeferredRenderer.h>
+#include <rg/Lightmap.h>
+#include <rg/ShadowMaps.h>
+#include <rg/TextureLoader.h>
+#include <rg/TexturePack.h>
+
+#include <chrono>
 #include <iostream>
 #include <fstream>
-#include <model.h>
+#include <memory>
+#include <sstream>
+#include <learnopengl/model.h>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-unsigned int loadTexture(char const * path);
-unsigned int loadCubemap(vector<std::string> faces);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void updateWindowTitle(GLFWwindow *window, float currentFrame);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -35,10 +58,21 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int matrix[20][20];
 int hint = 0;
 
-int main() {
+using namespace rg::literals;
+
+// uniforms set in the render loop, constexpr so their names are hashed by the compiler in every build
+constexpr rg::UniformId MODEL_UNIFORM = "model"_uniform;
+
+rg::Settings settings;
+bool meshModeChanged = false;
+
+int main(int argc, char **argv) {
+    auto startupBegin = std::chrono::steady_clock::now();
+    if (!rg::parseSettings(argc, argv, settings))
+        return 0;
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -46,14 +80,13 @@ int main() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    std::fstream file;
-    file.open("src/map.txt");
-    for (int i = 0; i < 19; i++) {
-        for (int j = 0; j < 19; j++) {
-            file >> matrix[i][j];
-        }
+    rg::Maze maze;
+    if (settings.generateSize > 0) {
+        maze = rg::Maze::generate(settings.generateSize, settings.generateSize, settings.seed);
+        camera.Position = glm::vec3(1.0f, 0.0f, 1.0f);
+    } else {
+        maze = rg::Maze::loadFromFile(settings.mapPath);
     }
-    file.close();
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -72,6 +105,7 @@ int main() {
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
 
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -89,60 +123,103 @@ int main() {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDepthFunc(GL_LESS);
 
-    Shader Shader1("resources/shaders/wall.vs", "resources/shaders/wall.fs");
-    Shader Shader2("resources/shaders/floor.vs", "resources/shaders/floor.fs");
+    if (!settings.benchmark.empty()) {
+        bool passed = true;
+        if (settings.benchmark == "uniforms")
+            rg::benchmarkUniforms();
+        else if (settings.benchmark == "normals")
+            rg::benchmarkNormalMatrix(maze, settings.meshMode);
+        else if (settings.benchmark == "meshes")
+            rg::benchmarkMeshModes(settings.generateSize > 0 ? std::vector<rg::Maze>{maze} :
+                                   std::vector<rg::Maze>{rg::Maze::generate(256, 256, settings.seed), rg::Maze::generate(1024, 1024, settings.seed)},
+                                   settings.chunkSize);
+        else if (settings.benchmark == "occlusion")
+            rg::benchmarkOcclusion(settings.generateSize > 0 ? maze : rg::Maze::generate(513, 513, settings.seed), settings.meshMode,
+                                   settings.chunkSize, settings.streamRadius);
+        else if (settings.benchmark == "lights")
+            rg::benchmarkLights(maze, settings.meshMode);
+        else if (settings.benchmark == "renderers")
+            rg::benchmarkRenderers(maze, settings.meshMode);
+        else if (settings.benchmark == "models") {
+            rg::writeSphereObj(FileSystem::getPath("cache/bench_sphere.obj"), 256, 512);
+            passed = rg::benchmarkModels({FileSystem::getPath("resources/objects/lantern/Gamelantern_updated.obj"),
+                                          FileSystem::getPath("cache/bench_sphere.obj")}, FileSystem::getPath("cache"));
+        } else if (settings.benchmark == "vertices") {
+            rg::writeSphereObj(FileSystem::getPath("cache/bench_sphere.obj"), 256, 512);
+            rg::benchmarkVertexFormats({FileSystem::getPath("resources/objects/lantern/Gamelantern_updated.obj"),
+                                        FileSystem::getPath("cache/bench_sphere.obj")});
+        } else {
+            std::cout << "ERROR::BENCHMARK::UNKNOWN " << settings.benchmark << std::endl;
+            passed = false;
+        }
+        glfwTerminate();
+        return passed ? 0 : 1;
+    }
+
+    // the images decode on the worker threads while the maze, the lights and the shaders are set up below, until
+    // then every texture is a grey placeholder; with the cache they are S3TC compressed once and read from cache/,
+    // the ones in resources/textures.pack (see the texture_pack target) are uploaded straight from the mapped pack
+    rg::TexturePack texturePack;
+    if(settings.texturePack && texturePack.open(FileSystem::getPath("resources/textures.pack"), FileSystem::getPath("")))
+        std::cout << "Texture pack " << texturePack.entryCount() << " textures, " << texturePack.mappedBytes() / 1024 << " KB mapped" << std::endl;
+    rg::TextureLoader textures(settings.textureThreads, settings.texturePixelBuffers,
+                               settings.textureCache ? FileSystem::getPath("cache") : "");
+    textures.usePack(&texturePack);
+    vector<std::string> faces
+            {
+                    FileSystem::getPath("resources/textures/skybox1/right1.jpg"),
+                    FileSystem::getPath("resources/textures/skybox1/left1.jpg"),
+                    FileSystem::getPath("resources/textures/skybox1/top1.jpg"),
+                    FileSystem::getPath("resources/textures/skybox1/bottom1.jpg"),
+                    FileSystem::getPath("resources/textures/skybox1/front1.jpg"),
+                    FileSystem::getPath("resources/textures/skybox1/back1.jpg")
+            };
+    unsigned int cubemapTexture = textures.loadCubemap(faces);
+    // every wall and floor texture is a layer of one array, the vertices of the maze say which layers they use
+    vector<std::string> mazeLayers;
+    for(const char *layer : rg::MAZE_TEXTURE_LAYERS)
+        mazeLayers.push_back(FileSystem::getPath(layer));
+    unsigned int mazeTextures = textures.loadArray(mazeLayers, rg::MAZE_TEXTURE_SIZE);
+    unsigned int transparentTexture = textures.load2D(FileSystem::getPath("resources/textures/powerup_speed.png"));
+
+    // the five lanterns of the default map, or one every few cells
+    std::vector<glm::vec3> pointLightPositions;
+    if(settings.lanternSpacing > 0)
+        pointLightPositions = rg::placeLanterns(maze, settings.lanternSpacing);
+    else {
+        for(int i = 0; i < 5; i++)
+            pointLightPositions.push_back(glm::vec3(0.58f+4*i, 1.0f,1.0f+4*i));
+    }
+
+    // the lanterns never move, their light data is uploaded once; the cluster lists change per frame, the cell lists
+    // only when the camera moves into another block
+    rg::LightClusters lightClusters;
+    lightClusters.create();
+    lightClusters.setLights(pointLightPositions, glm::vec3(1.0f, 0.22f, 0.20f));
+    rg::LightGrid lightGrid;
+    lightGrid.create();
+    std::cout << pointLightPositions.size() << " lanterns" << std::endl;
+
+    // the lanterns and the maze are static, so their light is baked once (or read from the cache) and the maze
+    // shaders only compute the spot light per fragment
+    rg::Lightmap lightmap;
+    bool lightmapped = settings.lightmap &&
+                       lightmap.upload(rg::loadOrBakeLightmap(maze, lightClusters, glm::vec3(1.0f, 0.22f, 0.20f), FileSystem::getPath("cache")));
+
+    // the maze is built in world space, so its model matrix is the identity and normals need no transform
+    glm::mat4 mazeModel = glm::mat4(1.0f);
+    rg::NormalMatrixMode normalMode = rg::resolveNormalMatrixMode(settings.normalMode, mazeModel);
+    std::string mazeDefines = rg::normalMatrixDefines(normalMode) + rg::lightCullingDefines(settings.lightCulling) + (lightmapped ? "#define LIGHTMAP\n" : "") +
+                              rg::shadowDefines(settings.shadows);
+    Shader mazeShader("resources/shaders/maze.vs", "resources/shaders/maze.fs", mazeDefines);
     Shader skyboxShader("resources/shaders/Skybox.vs", "resources/shaders/Skybox.fs");
     Shader ShaderTransp("resources/shaders/transparent.vs", "resources/shaders/transparent.fs");
 
 
+
     // build and compile our shader program
     // ------------------------------------
 
-    float vertices[] = {
-            // positions          // normals           // texture coords
-            -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-            0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
-            0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-            0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-            -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
-            -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-
-            -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-            0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f,
-            0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-            0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-            -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  1.0f,
-            -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-
-            -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-            -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-            -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-            -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-            -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-            -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-
-            0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f, 0.0f,  0.0f,
-            0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f, 1.0f,  0.0f,
-            0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f, 1.0f,  1.0f,
-            0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f, 1.0f,  1.0f,
-            0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f, 0.0f,  1.0f,
-            0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f, 0.0f,  0.0f,
-
-            -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-            0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f,
-            0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-            0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-            -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
-            -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-
-            -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-            0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
-            0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-            0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-            -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-            -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
-    };
-
     float skyboxVertices[] = {
             // positions
             -1.0f,  1.0f, -1.0f,
@@ -199,24 +276,35 @@ int main() {
             1.0f,  0.5f,  0.0f,  1.0f,  0.0f
     };
 
-    glm::vec3 pointLightPositions[5];
-    for(int i = 0; i < 5; i++)
-        pointLightPositions[i] = glm::vec3(0.58f+4*i, 1.0f,1.0f+4*i);
+    glm::mat4 hintModels[4];
+    hintModels[0] = glm::translate(glm::mat4(1.0f), glm::vec3(10.5f, 0.0f, 9.5f));
+    hintModels[1] = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(5.5f, 0.0f, 2.5f)), 1.57f, glm::vec3(0.0f, 1.0f, 0.0f));
+    hintModels[2] = glm::translate(glm::mat4(1.0f), glm::vec3(7.5f, 0.0f, 4.5f));
+    hintModels[3] = glm::translate(glm::mat4(1.0f), glm::vec3(12.5f, 0.0f, 15.5f));
+
+    rg::UniformBuffer frameBuffer;
+    frameBuffer.create(sizeof(rg::FrameData), rg::FRAME_DATA_BINDING);
+    rg::FrameData frameData;
+    // GPU time of the wall and floor passes, shown in the window title
+    rg::GpuTimer mazeTimer;
+    mazeTimer.create();
+
+    // bounding boxes for frustum culling; the lantern boxes are collected each frame from the lanterns near the camera
+    rg::AabbBatch lanternBounds;
+    std::vector<unsigned int> nearbyLanterns;
+    rg::AabbBatch hintBounds;
+    for(int i = 0; i < 4; i++) {
+        glm::vec3 a = glm::vec3(hintModels[i] * glm::vec4(0.0f, -0.5f, 0.0f, 1.0f));
+        glm::vec3 b = glm::vec3(hintModels[i] * glm::vec4(1.0f, 0.5f, 0.0f, 1.0f));
+        hintBounds.add(glm::min(a, b), glm::max(a, b));
+    }
+    std::vector<unsigned char> lanternVisible, hintVisible;
+    rg::GridVisibility visibility;
 
 
-    unsigned int VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6*sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glBindVertexArray(0);
+    // static maze geometry, only faces next to open cells are kept; chunks are built around the camera on worker threads
+    rg::MazeWorld world(maze, settings.meshMode, settings.chunkSize, settings.maxResidentChunks);
+    std::cout << "Maze " << maze.width << "x" << maze.height << " in " << settings.chunkSize << "x" << settings.chunkSize << " chunks" << std::endl;
 
 
     unsigned int transparentVAO, transparentVBO;
@@ -242,46 +330,102 @@ int main() {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glBindVertexArray(0);
 
-    vector<std::string> faces
-            {
-                    FileSystem::getPath("resources/textures/skybox1/right1.jpg"),
-                    FileSystem::getPath("resources/textures/skybox1/left1.jpg"),
-                    FileSystem::getPath("resources/textures/skybox1/top1.jpg"),
-                    FileSystem::getPath("resources/textures/skybox1/bottom1.jpg"),
-                    FileSystem::getPath("resources/textures/skybox1/front1.jpg"),
-                    FileSystem::getPath("resources/textures/skybox1/back1.jpg")
-            };
-    unsigned int cubemapTexture = loadCubemap(faces);
-
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
-    // wall
-    Shader1.use();
-    unsigned int diffuseMapWall = loadTexture(FileSystem::getPath("resources/textures/brickwall.jpg").c_str());
-    unsigned int specularMapWall = loadTexture(FileSystem::getPath("resources/textures/brickwall_normal.jpg").c_str());
-
-    Shader1.setInt("material.diffuse", 1);
-    Shader1.setInt("material.specular", 2);
+    // walls and floor
+    mazeShader.use();
+    mazeShader.setInt("mazeTextures", rg::MAZE_TEXTURE_UNIT);
+    // light colours and the spot light cone do not change, the camera comes from FrameData and the lanterns from the light buffers
+    mazeShader.setMat4("model", mazeModel);
+    mazeShader.setMat3("normalMatrix", rg::normalMatrix(mazeModel));
+    mazeShader.setInt("lightData", rg::LIGHT_DATA_UNIT);
+    mazeShader.setInt("clusterGrid", rg::CLUSTER_GRID_UNIT);
+    mazeShader.setInt("lightIndices", rg::LIGHT_INDEX_UNIT);
+    mazeShader.setInt("cellLightGrid", rg::CELL_GRID_UNIT);
+    mazeShader.setInt("cellLightIndices", rg::CELL_INDEX_UNIT);
+    rg::setMazeLighting(mazeShader);
 
     ShaderTransp.use();
-    unsigned int transparentTexture = loadTexture(FileSystem::getPath("resources/textures/powerup_speed.png").c_str());
     ShaderTransp.setInt("texture1", 4);
 
 
-    // floor
-    Shader2.use();
-    unsigned int diffuseMapFloor = loadTexture(FileSystem::getPath("resources/textures/stone.jpg").c_str());
-    Shader2.setInt("material.diffuse", 3);
+    Shader ShaderModel("resources/shaders/model.vs", "resources/shaders/model.fs", meshFormatDefines(settings.meshFormat));
+    ShaderModel.use();
 
+    // depth prepass and overdraw view, both only read the maze positions
+    Shader depthShader("resources/shaders/depth_prepass.vs", "resources/shaders/depth_prepass.fs");
+    depthShader.use();
+    depthShader.setMat4("model", mazeModel);
+    Shader overdrawShader("resources/shaders/depth_prepass.vs", "resources/shaders/overdraw.fs");
+    overdrawShader.use();
+    overdrawShader.setMat4("model", mazeModel);
+    // fragments of the lit maze pass, divided by the pixels it is the overdraw shown in the window title
+    rg::SampleCounter litCounter;
+    litCounter.create();
+
+    for(const Shader *shader : {&mazeShader, &skyboxShader, &ShaderTransp, &ShaderModel, &depthShader, &overdrawShader}) {
+        shader->bindUniformBlock("FrameData", rg::FRAME_DATA_BINDING);
+    }
 
-    Shader ShaderModel("resources/shaders/model.vs", "resources/shaders/model.fs");
-    ShaderModel.use();
+    // G-buffer programs and lighting passes of --renderer deferred, only compiled when that path is used
+    std::unique_ptr<rg::DeferredRenderer> deferred;
+    if(settings.renderPath == rg::RENDER_DEFERRED) {
+        deferred = std::make_unique<rg::DeferredRenderer>(mazeDefines, meshFormatDefines(settings.meshFormat));
+        deferred->create(rg::MAZE_TEXTURE_UNIT);
+        if(lightmapped)
+            deferred->useLightmap(lightmap);
+    }
+    if(lightmapped) {
+        lightmap.setUniforms(mazeShader);
+    }
 
-    Model  lantern(FileSystem::getPath("resources/objects/lantern/Gamelantern_updated.obj"));
+    // lantern shadow maps are rendered once and cached, only the spot light's is redrawn every frame; the lightmap
+    // has the lantern shadows baked in already; nothing is created without --shadows
+    std::unique_ptr<rg::ShadowMaps> shadows;
+    rg::GpuTimer shadowTimer;
+    shadowTimer.create();
+    if(settings.shadows) {
+        shadows = std::make_unique<rg::ShadowMaps>();
+        shadows->create(pointLightPositions.size(), (std::size_t)settings.shadowMemoryMB << 20, !lightmapped);
+        shadows->setUniforms(mazeShader);
+        if(deferred)
+            deferred->useShadows(*shadows);
+        shadowTimer.begin();
+        unsigned int rendered = shadows->updateLanterns(maze, lightClusters, camera.Position, settings.streamRadius);
+        shadowTimer.end();
+        std::cout << "Shadow maps " << shadows->memoryBytes() / (1024 * 1024) << " MB, " << shadows->slotCount() << " lantern slots, "
+                  << rendered << " rendered at load in " << shadowTimer.finish() << " ms gpu" << std::endl;
+    }
+
+    // after the first run the lantern is read from its mesh cache file in cache/ instead of imported by Assimp; by
+    // default only its GPU buffers are kept
+    auto lanternStart = std::chrono::steady_clock::now();
+    Model  lantern(FileSystem::getPath("resources/objects/lantern/Gamelantern_updated.obj"), false, &textures,
+                   settings.meshCache ? FileSystem::getPath("cache") : "", settings.meshRetention, settings.meshFormat,
+                   settings.meshOptimization);
+    std::chrono::duration<double, std::milli> lanternTime = std::chrono::steady_clock::now() - lanternStart;
+    std::cout << "Lantern loaded in " << lanternTime.count() << " ms (" << (lantern.cached ? "mesh cache" : "assimp") << "), "
+              << lantern.gpuBytes() / 1024 << " KB on the GPU, " << lantern.importedCpuBytes / 1024 << " KB on the CPU after loading, "
+              << lantern.cpuBytes() / 1024 << " KB kept" << std::endl;
+    auto drawLanterns = [&](Shader &shader) {
+        shader.use();
+        for(unsigned int i = 0; i < nearbyLanterns.size(); i++) {
+            if(!lanternVisible[i])
+                continue;
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, pointLightPositions[nearbyLanterns[i]]);
+            model = glm::scale(model,glm::vec3(0.7f, 0.7f, 0.7f));
+            model = glm::rotate(model, 1.57f ,glm::vec3(0.0f, 0.5f, 0.0f));
+            shader.setMat4(MODEL_UNIFORM, model);
+            lantern.Draw(shader);
+        }
+    };
 
     // render loop
     // -----------
+    bool firstFrame = true;
+    bool texturesReported = false;
     while (!glfwWindowShouldClose(window)) {
 
         float currentFrame = glfwGetTime();
@@ -289,170 +433,165 @@ int main() {
         lastFrame = currentFrame;
 
         processInput(window);
+        if (meshModeChanged) {
+            world.setMeshMode(settings.meshMode);
+            meshModeChanged = false;
+        }
+        updateWindowTitle(window, currentFrame);
+        rg::frameStats().reset();
 
-        //glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        //glEnable(GL_DEPTH_TEST);
-
-        glBindVertexArray(VAO);
-
-        Shader1.use();
-
-        glm::mat4 model = glm::mat4(1.0f);
         glm::mat4 view;
         glm::mat4 projection;
         view = camera.GetViewMatrix();
         projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        Shader1.setMat4("view", view);
-        Shader1.setMat4("projection", projection);
-
-        Shader1.setVec3("viewPos", camera.Position);
-
-        for(int i = 0; i < 5; i++) {
-            Shader1.setVec3("pointLights[" + to_string(i) + "].position", pointLightPositions[i]);
-            Shader1.setVec3("pointLights[" + to_string(i) + "].ambient", 0.005f, 0.005f, 0.005f);
-            Shader1.setVec3("pointLights[" + to_string(i) + "].diffuse", 0.45f, 0.45f, 0.0f);
-            Shader1.setVec3("pointLights[" + to_string(i) + "].specular", 0.3f, 0.3f, 0.0f);
-            Shader1.setFloat("pointLights[" + to_string(i) + "].constant", 1.0f);
-            Shader1.setFloat("pointLights[" + to_string(i) + "].linear", 0.22);
-            Shader1.setFloat("pointLights[" + to_string(i) + "].quadratic", 0.20);
-        }
 
-        Shader1.setVec3("spotLight.position", camera.Position);
-        Shader1.setVec3("spotLight.direction", camera.Front);
-        Shader1.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-        Shader1.setVec3("spotLight.diffuse", 0.4f, 0.4f, 0.4f);
-        Shader1.setVec3("spotLight.specular", 0.04f, 0.04f, 0.04f);
-        Shader1.setFloat("spotLight.constant", 1.0f);
-        Shader1.setFloat("spotLight.linear", 0.045);
-        Shader1.setFloat("spotLight.quadratic", 0.0075);
-        Shader1.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-        Shader1.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-
-        Shader1.setFloat("material.shininess", 4.0f);
-
-        // walls
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, diffuseMapWall);
-
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, specularMapWall);
-
-        for(int i = 0; i < 19; i++) {
-            for(int j = 0; j < 19; j++) {
-                if(matrix[i][j] == 1) {
-                    model = glm::translate(glm::mat4(1.0f), glm::vec3((float)j, 0.0f, (float)i));
-                    Shader1.setMat4("model", model);
-                    Shader1.use();
-
-                    glDrawArrays(GL_TRIANGLES, 0, 36);
-                    model = glm::translate(glm::mat4(1.0f), glm::vec3((float)j, 1.0f, (float)i));
-                    Shader1.setMat4("model", model);
-                    //Shader1.use();
-                    glDrawArrays(GL_TRIANGLES, 0, 36);
+        // culling: one frustum per frame, tested against the chunk, lantern and hint boxes
+        rg::Frustum frustum = rg::Frustum::fromMatrix(projection * view);
+        world.update(camera.Position, settings.streamRadius);
+        world.cull(frustum);
+        lightClusters.gatherNearby(camera.Position, settings.streamRadius, nearbyLanterns);
+        lanternBounds.clear();
+        for(unsigned int i : nearbyLanterns)
+            lanternBounds.add(pointLightPositions[i] - glm::vec3(0.5f), pointLightPositions[i] + glm::vec3(0.5f));
+        rg::frameStats().cull.add(lanternBounds.size(), frustum.cullBoxes(lanternBounds, lanternVisible));
+        if(hint == 1)
+            rg::frameStats().cull.add(hintBounds.size(), frustum.cullBoxes(hintBounds, hintVisible));
+
+        // occlusion: walls block the view, so only cells reached by rays from the camera are drawn
+        if(settings.occlusion) {
+            float horizontalFov = 2.0f * atan(tan(glm::radians(camera.Zoom) * 0.5f) * (float)SCR_WIDTH / (float)SCR_HEIGHT);
+            if(visibility.compute(maze, camera.Position, camera.Front, horizontalFov, settings.streamRadius)) {
+                world.cullOccluded(visibility);
+                rg::frameStats().visibleCells = visibility.visibleCount();
+                for(unsigned int i = 0; i < nearbyLanterns.size(); i++) {
+                    const glm::vec3 &position = pointLightPositions[nearbyLanterns[i]];
+                    lanternVisible[i] = lanternVisible[i] && visibility.isVisible((int)round(position.x), (int)round(position.z));
+                }
+                if(hint == 1) {
+                    for(int i = 0; i < 4; i++)
+                        hintVisible[i] = hintVisible[i] && visibility.isVisible((int)round(hintModels[i][3].x), (int)round(hintModels[i][3].z));
                 }
             }
         }
 
-        // floor
-        Shader2.use();
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, diffuseMapFloor);
-
-        Shader2.setMat4("view", view);
-        Shader2.setMat4("projection", projection);
-        Shader2.setVec3("viewPos", camera.Position);
-
-        for(int i = 0; i < 5; i++) {
-            Shader2.setVec3("pointLights[" + to_string(i) + "].position", pointLightPositions[i]);
-            Shader2.setVec3("pointLights[" + to_string(i) + "].ambient", 0.005f, 0.005f, 0.0f);
-            Shader2.setVec3("pointLights[" + to_string(i) + "].diffuse", 0.4f, 0.4f, 0.0f);
-            Shader2.setVec3("pointLights[" + to_string(i) + "].specular", 0.05f, 0.05f, 0.0f);
-            Shader2.setFloat("pointLights[" + to_string(i) + "].constant", 1.0f);
-            Shader2.setFloat("pointLights[" + to_string(i) + "].linear", 0.22f);
-            Shader2.setFloat("pointLights[" + to_string(i) + "].quadratic", 0.20f);
-        }
-
-        Shader2.setVec3("spotLight.position", camera.Position);
-        Shader2.setVec3("spotLight.direction", camera.Front);
-        Shader2.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-        Shader2.setVec3("spotLight.diffuse", 0.6f, 0.6f, 0.6f);
-        Shader2.setVec3("spotLight.specular", 0.04f, 0.04f, 0.04f);
-        Shader2.setFloat("spotLight.constant", 1.0f);
-        Shader2.setFloat("spotLight.linear", 0.14);
-        Shader2.setFloat("spotLight.quadratic", 0.07);
-        Shader2.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-        Shader2.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-
-        Shader2.setFloat("material.shininess", 10.0f);
-
-        for(int i = 0; i < 19; i++) {
-            for(int j = 0; j < 19; j++) {
-                model = glm::translate(glm::mat4(1.0f), glm::vec3((float)j, -1.0f, (float)i));
-                Shader2.setMat4("model", model);
-                glDrawArrays(GL_TRIANGLES, 0, 36);
+        //glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        //glEnable(GL_DEPTH_TEST);
 
-            }
+        // one write of the camera data for every shader of the frame
+        frameData.projection = projection;
+        frameData.view = view;
+        frameData.viewPos = glm::vec4(camera.Position, 1.0f);
+        frameData.viewFront = glm::vec4(camera.Front, 0.0f);
+        glm::vec3 spotPosition = camera.Position + camera.Right * rg::SPOT_HAND_OFFSET.x + camera.Up * rg::SPOT_HAND_OFFSET.y;
+        frameData.spotPosition = glm::vec4(spotPosition, 1.0f);
+        if(shadows) {
+            shadows->setSpotLight(spotPosition, camera.Front);
+            shadows->fillFrameData(frameData);
+        }
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        if(lightmapped) {
+            lightmap.bind();
+        } else if(settings.lightCulling == rg::LIGHT_CULLING_CLUSTERS) {
+            lightClusters.update(camera.Position, view, projection, 0.1f, 100.0f);
+            rg::frameStats().lights = lightClusters.nearbyCount();
+            rg::frameStats().lightIndices = lightClusters.indexCount();
+        } else {
+            lightGrid.update(maze, lightClusters, camera.Position, settings.streamRadius);
+            rg::frameStats().lights = lightGrid.nearbyCount();
+            rg::frameStats().lightIndices = lightGrid.indexCount();
+        }
+        lightClusters.fillFrameData(frameData, framebufferWidth, framebufferHeight);
+        lightGrid.fillFrameData(frameData);
+        frameBuffer.update(&frameData);
+        lightClusters.bind();
+        lightGrid.bind();
+
+        // shadows: lanterns that came near get their map, a few per frame; the spot map is drawn from this frame's chunks
+        if(shadows) {
+            shadowTimer.begin();
+            rg::frameStats().shadowMapsRendered = shadows->updateLanterns(maze, lightClusters, camera.Position, settings.streamRadius, 4);
+            rg::frameStats().shadowedLights = shadows->shadowedCount();
+            Shader &casters = shadows->beginSpot();
+            world.drawWalls(true);
+            drawLanterns(casters);
+            shadows->endSpot();
+            shadowTimer.end();
+            rg::frameStats().shadowGpuMs = shadowTimer.elapsedMs();
+            shadows->bind();
         }
 
-
-        glActiveTexture(GL_TEXTURE0);
-
-        // model
-        ShaderModel.use();
-        ShaderModel.setMat4("view", view);
-        ShaderModel.setMat4("projection", projection);
-
-        for(int i=0; i < 5; i++) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, pointLightPositions[i]);
-            model = glm::scale(model,glm::vec3(0.7f, 0.7f, 0.7f));
-            model = glm::rotate(model, 1.57f ,glm::vec3(0.0f, 0.5f, 0.0f));
-            ShaderModel.setMat4("model", model);
-            lantern.Draw(ShaderModel);
+        // every maze material, shared by both render paths
+        glActiveTexture(GL_TEXTURE0 + rg::MAZE_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, mazeTextures);
+
+        mazeTimer.begin();
+        if(deferred && deferred->beginGeometry(framebufferWidth, framebufferHeight)) {
+            // surfaces into the G-buffer, then lighting into the window
+            deferred->mazeShader.use();
+            world.drawMaze();
+            glActiveTexture(GL_TEXTURE0);
+            drawLanterns(deferred->modelShader);
+            deferred->light(lightClusters, camera.Position, settings.streamRadius, frustum, projection, view);
+            rg::frameStats().lights = deferred->lightVolumeCount();
+        } else {
+            // depth prepass: only the nearest surface of every pixel passes GL_EQUAL, so the lighting runs once per pixel
+            if(settings.depthPrepass) {
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                depthShader.use();
+                world.drawMaze(true);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                glDepthFunc(GL_EQUAL);
+                glDepthMask(GL_FALSE);
+            }
+            litCounter.begin();
+            if(settings.overdraw) {
+                // the same depth test as the lit pass, each fragment adds one step
+                glBlendFunc(GL_ONE, GL_ONE);
+                overdrawShader.use();
+                world.drawMaze(true);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            } else {
+                mazeShader.use();
+                world.drawMaze();
+            }
+            litCounter.end();
+            rg::frameStats().litFragments = litCounter.count();
+            if(settings.depthPrepass) {
+                glDepthFunc(GL_LESS);
+                glDepthMask(GL_TRUE);
+            }
+            glActiveTexture(GL_TEXTURE0);
+            drawLanterns(ShaderModel);
         }
+        mazeTimer.end();
+        rg::frameStats().mazeGpuMs = mazeTimer.elapsedMs();
 
 
         if(hint == 1) {
             glActiveTexture(GL_TEXTURE4);
             ShaderTransp.use();
-            ShaderTransp.setMat4("view", view);
-            ShaderTransp.setMat4("projection", projection);
             glBindVertexArray(transparentVAO);
             glBindTexture(GL_TEXTURE_2D, transparentTexture);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(10.5f, 0.0f, 9.5f));
-            ShaderTransp.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(5.5f, 0.0f, 2.5f));
-            model = glm::rotate(model, 1.57f, glm::vec3(0.0f, 1.0f, 0.0f));
-            ShaderTransp.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(7.5f, 0.0f, 4.5f));
-            ShaderTransp.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(12.5f, 0.0f, 15.5f));
-            ShaderTransp.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            for(int i = 0; i < 4; i++) {
+                if(!hintVisible[i])
+                    continue;
+                ShaderTransp.setMat4(MODEL_UNIFORM, hintModels[i]);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                rg::frameStats().drawCalls++;
+            }
         }
 
 
         glDepthFunc(GL_LEQUAL);
         skyboxShader.use();
-        view = glm::mat4(glm::mat3(camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
         // skybox cube
         glBindVertexArray(skyboxVAO);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
         glDrawArrays(GL_TRIANGLES, 0, 36);
+        rg::frameStats().drawCalls++;
         glBindVertexArray(0);
         glDepthFunc(GL_LESS);
 
@@ -460,13 +599,38 @@ int main() {
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        // a couple of decoded images per frame so a big batch does not stall one frame
+        textures.update(2);
+        if (!texturesReported && textures.pendingCount() == 0) {
+            texturesReported = true;
+            std::cout << "Textures loaded after " << textures.completedMs() << " ms, " << textures.textureBytes() / 1024 << " KB on the gpu, "
+                      << textures.compressedCount() << " images compressed" << std::endl;
+        }
+        if (firstFrame) {
+            firstFrame = false;
+            std::cout << "First frame after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count()
+                      << " ms (" << (settings.textureThreads ? "async" : "sync") << " textures)" << std::endl;
+        }
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteBuffers(1, &skyboxVAO);
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    frameBuffer.release();
+    lightClusters.release();
+    lightGrid.release();
+    lightmap.release();
+    if(shadows)
+        shadows->release();
+    shadowTimer.release();
+    lantern.release();
+    litCounter.release();
+    if(deferred)
+        deferred->release();
+    mazeTimer.release();
+    world.shutdown();
+    textures.shutdown();
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -529,69 +693,50 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     camera.ProcessMouseScroll(yoffset);
 }
 
-unsigned int loadTexture(char const * path)
+// glfw: one-shot toggles, unlike processInput these fire once per key press
+// --------------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+    if (action != GLFW_PRESS)
+        return;
+
+    if (key == GLFW_KEY_G) {
+        // greedy, culled, cubes and back
+        settings.meshMode = settings.meshMode == rg::MAZE_MESH_GREEDY ? rg::MAZE_MESH_CULLED :
+                            settings.meshMode == rg::MAZE_MESH_CULLED ? rg::MAZE_MESH_CUBES : rg::MAZE_MESH_GREEDY;
+        meshModeChanged = true;
     }
-
-    return textureID;
+    if (key == GLFW_KEY_V)
+        settings.occlusion = !settings.occlusion;
+    if (key == GLFW_KEY_P)
+        settings.depthPrepass = !settings.depthPrepass;
+    if (key == GLFW_KEY_O)
+        settings.overdraw = !settings.overdraw;
 }
 
-unsigned int loadCubemap(vector<std::string> faces)
+// shows fps and the draw call count of the last frame, refreshed once per second
+void updateWindowTitle(GLFWwindow *window, float currentFrame)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
-    {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
+    static float lastUpdate = 0.0f;
+    static int frames = 0;
+    frames++;
+    if (currentFrame - lastUpdate < 1.0f)
+        return;
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    std::stringstream title;
+    title << "3D Maze | " << frames << " fps (" << 1000.0f / frames << " ms) | " << rg::frameStats().drawCalls << " draw calls | "
+          << rg::frameStats().triangles << " triangles | " << rg::frameStats().chunks << " chunks | "
+          << rg::frameStats().cull.visible << " visible, " << rg::frameStats().cull.culled << " culled, "
+          << rg::frameStats().occlusion.culled << " occluded | "
+          << rg::frameStats().visibleCells << " cells | "
+          << rg::frameStats().uniformsIssued << " uniforms sent, " << rg::frameStats().uniformsSkipped << " skipped | "
+          << rg::frameStats().mazeGpuMs << " ms maze gpu | "
+          << (double)rg::frameStats().litFragments / std::max(width * height, 1) << " overdraw" << (settings.depthPrepass ? " with" : " without") << " prepass | "
+          << rg::frameStats().shadowGpuMs << " ms shadows gpu, " << rg::frameStats().shadowedLights << " shadowed lanterns | "
+          << rg::frameStats().lights << " lights in " << rg::frameStats().lightIndices << " light list entries | " << rg::mazeMeshModeName(settings.meshMode);
+    glfwSetWindowTitle(window, title.str().c_str());
+    lastUpdate = currentFrame;
+    frames = 0;
 }
@@ -0,0 +1,27 @@
+//
+// Created by bambino on 3.3.21..
+//
+
+// replaces the global operator new and delete to count the allocations of every thread, see rg/AllocationStats.h;
+// the array and nothrow forms of the standard library forward to these. Only linked in with -DRG_ALLOCATION_STATS=ON.
+#include <rg/AllocationStats.h>
+
+#include <cstdlib>
+#include <new>
+
+void *operator new(std::size_t size) {
+    rg::AllocationCount &count = rg::threadAllocations();
+    count.allocations++;
+    count.bytes += size;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,47 @@
+//
+// Created by bambino on 1.3.21..
+//
+
+// Bundles textures into one pack for rg::TexturePack, S3TC compressed with all their mips:
+//   texture_packer <pack> <image>...
+// The paths are relative to the resource root, the same strings the game passes to FileSystem::getPath.
+
+#include <stb_image.h>
+
+#include <learnopengl/filesystem.h>
+#include <rg/TexturePack.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cout << "usage: texture_packer <pack> <image>...\n";
+        return 1;
+    }
+    std::vector<rg::TexturePackSource> sources;
+    std::size_t sourceBytes = 0, packedBytes = 0;
+    for (int i = 2; i < argc; i++) {
+        std::string path = FileSystem::getPath(argv[i]);
+        int width, height, components;
+        unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &components, 0);
+        if (!pixels) {
+            std::cout << "ERROR::TEXTURE_PACKER::LOAD_FAILED " << path << std::endl;
+            return 1;
+        }
+        rg::TexturePackSource source{argv[i], rg::textureSourceStamp(path), rg::compressImage(pixels, width, height, components)};
+        stbi_image_free(pixels);
+        sourceBytes += (std::size_t)width * height * components;
+        packedBytes += source.image.bytes();
+        std::cout << argv[i] << " " << width << "x" << height << ", " << source.image.levels.size() << " levels, "
+                  << source.image.bytes() / 1024 << " KB" << std::endl;
+        sources.push_back(std::move(source));
+    }
+    std::string packPath = FileSystem::getPath(argv[1]);
+    if (!rg::writeTexturePack(packPath, std::move(sources)))
+        return 1;
+    std::cout << "Packed " << argc - 2 << " textures into " << packPath << ", " << packedBytes / 1024 << " KB of blocks from "
+              << sourceBytes / 1024 << " KB of pixels" << std::endl;
+    return 0;
+}